@@ -12,10 +12,14 @@
 #include <elden-x/utils/modutils.hpp>
 
 #include "erdyes_apply_materials.hpp"
+#include "erdyes_capture.hpp"
 #include "erdyes_config.hpp"
 #include "erdyes_local_player.hpp"
 #include "erdyes_messages.hpp"
+#include "erdyes_net_players.hpp"
 #include "erdyes_talkscript.hpp"
+#include "erdyes_telemetry.hpp"
+#include "erdyes_trace.hpp"
 
 using namespace std;
 
@@ -30,15 +34,37 @@ static void setup_mod() {
     spdlog::info("Sleeping for {}ms...", erdyes::config::initialize_delay);
     this_thread::sleep_for(chrono::milliseconds(erdyes::config::initialize_delay));
 
+    if (erdyes::config::telemetry) {
+        erdyes::telemetry::init();
+    }
+
     spdlog::info("Hooking messages...");
-    erdyes::setup_messages();
+    {
+        erdyes::trace::scope trace_scope{"setup_messages"};
+        erdyes::setup_messages();
+    }
 
-    erdyes::local_player::init();
+    {
+        erdyes::trace::scope trace_scope{"local_player::init"};
+        erdyes::local_player::init();
+    }
+
+    spdlog::info("Starting network thread...");
+    {
+        erdyes::trace::scope trace_scope{"net_players::init"};
+        erdyes::net_players::init();
+    }
 
     spdlog::info("Hooking talkscripts...");
-    erdyes::setup_talkscript();
+    {
+        erdyes::trace::scope trace_scope{"setup_talkscript"};
+        erdyes::setup_talkscript();
+    }
 
-    erdyes::apply_materials_init();
+    {
+        erdyes::trace::scope trace_scope{"apply_materials_init"};
+        erdyes::apply_materials_init();
+    }
 
     modutils::enable_hooks();
     spdlog::info("Initialized mod");
@@ -82,6 +108,14 @@ bool WINAPI DllMain(HINSTANCE dll_instance, unsigned int fdw_reason, void *lpv_r
 
         erdyes::load_config(folder / "erdyes.ini");
 
+        if (erdyes::config::trace) {
+            erdyes::trace::init(folder / "erdyes_trace.json");
+        }
+
+        if (erdyes::config::capture) {
+            erdyes::capture::init(folder / "erdyes_capture.bin");
+        }
+
 #ifndef _DEBUG
         if (erdyes::config::debug) {
             enable_debug_logging(logger);
@@ -99,6 +133,9 @@ bool WINAPI DllMain(HINSTANCE dll_instance, unsigned int fdw_reason, void *lpv_r
     } else if (fdw_reason == DLL_PROCESS_DETACH && lpv_reserved != nullptr) {
         try {
             mod_thread.join();
+            erdyes::net_players::deinit();
+            erdyes::capture::deinit();
+            erdyes::trace::deinit();
             modutils::deinitialize();
             spdlog::info("Deinitialized mod");
         } catch (runtime_error const &e) {
@@ -0,0 +1,96 @@
+/**
+ * erdyes_animated_dyes.cpp
+ *
+ * Dyes that change color over time. Each animation is baked into a lookup table when the config
+ * is loaded, and sampled once per frame so applying it to a character is a single table read.
+ */
+#include "erdyes_animated_dyes.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+struct animation {
+    unsigned int id;
+    float period;
+    array<erdyes::animated_dyes::rgb, erdyes::animated_dyes::lut_size> lut;
+};
+
+static vector<animation> animations;
+static vector<erdyes::animated_dyes::rgb> current_colors;
+
+// Seconds since the first animation was updated. This is a double so it stays precise for far
+// longer than any session, without wrapping in a way that would make animations jump.
+static double clock_time = 0.0;
+
+/**
+ * Convert a hue from 0 to 1 to a fully saturated RGB color
+ */
+static erdyes::animated_dyes::rgb hue_to_rgb(float hue) {
+    auto channel = [hue](float offset) {
+        auto k = fmod(offset + hue * 6.0f, 6.0f);
+        return 1.0f - max(0.0f, min({k, 4.0f - k, 1.0f}));
+    };
+    return {channel(5.0f), channel(3.0f), channel(1.0f)};
+}
+
+int erdyes::animated_dyes::add(unsigned int id, const vector<rgb> &keyframes, float period) {
+    auto &new_animation = animations.emplace_back(id, period);
+
+    for (int i = 0; i < lut_size; i++) {
+        auto t = static_cast<float>(i) / lut_size;
+
+        if (keyframes.empty()) {
+            new_animation.lut[i] = hue_to_rgb(t);
+            continue;
+        }
+
+        // Linearly interpolate between each keyframe and the next one, looping back to the first
+        auto position = t * keyframes.size();
+        auto keyframe_index = static_cast<size_t>(position);
+        auto &from = keyframes[keyframe_index];
+        auto &to = keyframes[(keyframe_index + 1) % keyframes.size()];
+        auto blend = position - keyframe_index;
+        for (int channel = 0; channel < 3; channel++) {
+            new_animation.lut[i][channel] = from[channel] + (to[channel] - from[channel]) * blend;
+        }
+    }
+
+    current_colors.push_back(new_animation.lut[0]);
+
+    return static_cast<int>(animations.size() - 1);
+}
+
+int erdyes::animated_dyes::find(unsigned int id) {
+    if (id == 0) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < animations.size(); i++) {
+        if (animations[i].id == id) {
+            return static_cast<int>(i);
+        }
+    }
+
+    return -1;
+}
+
+void erdyes::animated_dyes::update(float delta_time) {
+    if (animations.empty()) {
+        return;
+    }
+
+    clock_time += delta_time;
+
+    for (size_t i = 0; i < animations.size(); i++) {
+        auto &animation = animations[i];
+        auto phase = fmod(clock_time, static_cast<double>(animation.period)) / animation.period;
+        auto lut_index = static_cast<int>(phase * lut_size) % lut_size;
+        current_colors[i] = animation.lut[lut_index];
+    }
+}
+
+const erdyes::animated_dyes::rgb &erdyes::animated_dyes::get_current(int index) {
+    return current_colors[index];
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+namespace erdyes {
+namespace animated_dyes {
+
+// Number of samples baked for one period of each animated dye
+static constexpr int lut_size = 64;
+
+typedef std::array<float, 3> rgb;
+
+/**
+ * Bake an animated dye that loops through the given keyframe colors over the given period (in
+ * seconds), or cycles through every hue if no keyframes are given.
+ *
+ * @param id identifies the animation across the network, so peers with the same definition can
+ * sync it without sending any colors
+ * @returns the index of the new animation
+ */
+int add(unsigned int id, const std::vector<rgb> &keyframes, float period);
+
+/**
+ * @returns the index of the animation with the given network ID, or -1 if there isn't one
+ */
+int find(unsigned int id);
+
+/**
+ * Advance the shared animation clock and sample the current color of every animation. This
+ * should be called once per frame.
+ */
+void update(float delta_time);
+
+/**
+ * @returns the current color of the given animation, as sampled in the last update()
+ */
+const rgb &get_current(int index);
+
+}
+}
@@ -4,13 +4,23 @@
  * Applies colors to the player characters based on the current local and networked selections
  */
 #include "erdyes_apply_materials.hpp"
+#include "erdyes_animated_dyes.hpp"
+#include "erdyes_capture.hpp"
+#include "erdyes_chr_dyes.hpp"
 #include "erdyes_config.hpp"
 #include "erdyes_local_player.hpp"
+#include "erdyes_modifier_batch.hpp"
 #include "erdyes_net_players.hpp"
+#include "erdyes_scheduler.hpp"
+#include "erdyes_state.hpp"
+#include "erdyes_telemetry.hpp"
+#include "erdyes_trace.hpp"
 
 #include <spdlog/spdlog.h>
 #include <elden-x/chr/world_chr_man.hpp>
 #include <elden-x/utils/modutils.hpp>
+#include <array>
+#include <chrono>
 #include <string>
 
 #define WIN32_LEAN_AND_MEAN
@@ -23,11 +33,57 @@ static const wstring albedo2_material_ex_name = L"[Albedo]_2_[Tint]";
 static const wstring albedo3_material_ex_name = L"[Albedo]_3_[Tint]";
 static const wstring albedo4_material_ex_name = L"[Albedo]_4_[Tint]";
 
-static constexpr int player_copy_sentinel = 0;
-
 static float cumulative_time = 0.0f;
 static constexpr float net_update_interval = 0.1f;
 
+// Maximum time spent running deferred tasks each frame
+static constexpr auto frame_budget = chrono::microseconds{250};
+
+// The dye selections are sent when they change, and also every this many send intervals so
+// players who just joined receive them
+static constexpr int resync_interval_sends = 10;
+
+struct net_slot_cache_entry {
+    er::CS::PlayerIns *player;
+    unsigned long long steam_id;
+    unsigned int net_generation;
+    int slot;
+};
+
+// Direct-mapped cache of the net_players slot last found for each networked character, so the
+// slot search only happens when a player joins or a cache line is replaced
+static array<net_slot_cache_entry, 2 * erdyes::net_players::max_net_players> net_slot_cache;
+
+/**
+ * @returns the net_players slot with dyes for the given networked character, or -1 if none
+ */
+static int get_net_slot(er::CS::PlayerIns *player, unsigned long long steam_id) {
+    auto hash = reinterpret_cast<uintptr_t>(player) >> 4;
+    auto &entry = net_slot_cache[hash % net_slot_cache.size()];
+    auto net_generation = erdyes::state::generations.net_dyes;
+    if (entry.player == player && entry.steam_id == steam_id) {
+        // Slots can't change without a new snapshot of the received dye states
+        if (entry.net_generation == net_generation) {
+            if (erdyes::config::telemetry) {
+                erdyes::telemetry::add(erdyes::telemetry::counters->net_slot_cache_hits);
+            }
+            return entry.slot;
+        }
+        entry.slot = erdyes::net_players::find_slot(steam_id, entry.slot);
+    } else {
+        entry.slot = erdyes::net_players::find_slot(steam_id);
+    }
+
+    if (erdyes::config::telemetry) {
+        erdyes::telemetry::add(erdyes::telemetry::counters->net_slot_cache_misses);
+    }
+
+    entry.player = player;
+    entry.steam_id = steam_id;
+    entry.net_generation = net_generation;
+    return entry.slot;
+}
+
 /**
  * Returns true if the local player's dyes shouldn't be displayed on other player's screens
  * and vice versa
@@ -43,98 +99,220 @@ static bool is_client_side_only() {
     return result;
 }
 
+/**
+ * Returns true if dyes shouldn't be applied to the given character because it isn't loaded or is
+ * too far away from the main player to be worth it. There's no known way to check if a character
+ * is actually being rendered, so a character is treated as loaded if it has a model param
+ * modifier module.
+ */
+static bool is_culled(er::CS::ChrIns *chr, er::CS::ChrIns *main_player) {
+    if (!chr->modules || !chr->modules->model_param_modifier_module) {
+        return true;
+    }
+
+    auto cull_distance = erdyes::config::cull_distance;
+    if (cull_distance <= 0.0f || !main_player || !chr->modules->physics_module ||
+        !main_player->modules || !main_player->modules->physics_module) {
+        return false;
+    }
+
+    auto &position = chr->modules->physics_module->position;
+    auto &main_player_position = main_player->modules->physics_module->position;
+    auto dx = position.x - main_player_position.x;
+    auto dy = position.y - main_player_position.y;
+    auto dz = position.z - main_player_position.z;
+    return dx * dx + dy * dy + dz * dz > cull_distance * cull_distance;
+}
+
 static void apply_colors(er::CS::ChrIns *, const erdyes::state::dye_values &);
 
-// CS::PlayerIns::Update(float delta_time)
-static void (*cs_player_update)(er::CS::PlayerIns *, float);
-static void cs_player_update_detour(er::CS::PlayerIns *_this, float delta_time) {
+/**
+ * Record that dyes from the given player, or 0 for the local player, are about to be applied to a
+ * character
+ */
+static void capture_character(er::CS::ChrIns *chr, unsigned long long steam_id) {
+    if (erdyes::capture::enabled) {
+        erdyes::capture::record_character(
+            steam_id, chr->modules->model_param_modifier_module->modifiers.size());
+    }
+}
+
+/**
+ * Send the dye selections to other connected players, so their games can show the dyes if they
+ * have the mod installed
+ */
+static void send_local_player_dyes() {
+    erdyes::trace::scope trace_scope{"send_local_player_dyes"};
+
     static auto empty_dyes = erdyes::state::dye_values{};
+    static auto empty_indices = array<int, 6>{-1, -1, -1, -1, -1, -1};
+    static unsigned int sent_generation = 0;
+    static bool sent_client_side_only = false;
+    static int sends_until_resync = 0;
 
-    cs_player_update(_this, delta_time);
+    auto client_side_only = is_client_side_only();
+    auto generation = erdyes::state::generations.local_dyes;
+    if (generation == sent_generation && client_side_only == sent_client_side_only &&
+        --sends_until_resync > 0) {
+        return;
+    }
+    sent_generation = generation;
+    sent_client_side_only = client_side_only;
+    sends_until_resync = resync_interval_sends;
 
-    auto &chr_asm = _this->game_data->equip_game_data.chr_asm;
+    if (client_side_only) {
+        erdyes::net_players::send_messages(empty_dyes, empty_indices);
+    } else {
+        erdyes::net_players::send_messages(erdyes::local_player::get_selected_dyes(),
+                                           erdyes::local_player::get_selected_indices());
+    }
+}
+
+/**
+ * Update and apply the dyes of a character after the game updates it
+ */
+static void update_player(er::CS::PlayerIns *_this,
+                          er::CS::PlayerIns *main_player,
+                          float delta_time) {
+    if (_this == main_player) {
+        if (erdyes::capture::enabled) {
+            erdyes::capture::record_frame(delta_time);
+        }
+
+        erdyes::trace::update();
+        erdyes::chr_dyes::next_frame();
+        erdyes::animated_dyes::update(delta_time);
+        erdyes::net_players::update();
 
-    if (_this == er::CS::WorldChrManImp::instance()->main_player) {
         // Check the loaded save slot for the latest dye selections
         erdyes::local_player::update();
+        if (erdyes::capture::enabled) {
+            erdyes::capture::record_local_indices(erdyes::local_player::get_selected_indices());
+        }
 
         // Apply the dye selections locally to the main player
         auto local_player_dyes = erdyes::local_player::get_selected_dyes();
+        capture_character(_this, 0);
         apply_colors(_this, local_player_dyes);
 
-        // Also periodically send the dye selections to other connected players, so their games can
-        // show the dyes if they have the mod installed
+        // Also periodically sync the dye selections with other connected players
         cumulative_time += delta_time;
         if (cumulative_time > net_update_interval) {
             cumulative_time -= net_update_interval;
-            erdyes::net_players::send_messages(is_client_side_only() ? empty_dyes
-                                                                     : local_player_dyes);
+            erdyes::scheduler::post(send_local_player_dyes);
+            erdyes::scheduler::post(erdyes::net_players::remove_disconnected_players);
         }
+
+        erdyes::scheduler::run(frame_budget);
     }
-    // Apply the main player logic to any mimic tears as well
-    else if (chr_asm.gear_param_ids.unused4 == player_copy_sentinel) {
-        auto local_player_dyes = erdyes::local_player::get_selected_dyes();
-        apply_colors(_this, local_player_dyes);
+    // Apply the copied player's dyes to any mimic tears as well
+    else if (auto assignment = erdyes::chr_dyes::find(_this)) {
+        if (!is_culled(_this, main_player)) {
+            if (assignment->source == erdyes::chr_dyes::dye_source::local_player) {
+                capture_character(_this, 0);
+                apply_colors(_this, erdyes::local_player::get_selected_dyes());
+            } else if (!is_client_side_only()) {
+                assignment->net_slot =
+                    erdyes::net_players::find_slot(assignment->steam_id, assignment->net_slot);
+                capture_character(_this, assignment->steam_id);
+                apply_colors(_this, erdyes::net_players::get_selected_dyes(assignment->net_slot));
+            }
+        }
     } else {
         auto network_session = _this->session_holder.network_session;
         if (network_session) {
-            // Check the network buffer for dye updates from other players
-            erdyes::net_players::receive_messages();
-
             // Apply the dye selections we've received from this player
-            auto net_player_dyes =
-                is_client_side_only()
-                    ? empty_dyes
-                    : erdyes::net_players::get_selected_dyes(network_session->steam_id);
-            apply_colors(_this, net_player_dyes);
+            if (!is_client_side_only() && !is_culled(_this, main_player)) {
+                auto slot = get_net_slot(_this, network_session->steam_id);
+                capture_character(_this, network_session->steam_id);
+                apply_colors(_this, erdyes::net_players::get_selected_dyes(slot));
+            }
         }
     }
 }
 
+// CS::PlayerIns::Update(float delta_time)
+static void (*cs_player_update)(er::CS::PlayerIns *, float);
+static void cs_player_update_detour(er::CS::PlayerIns *_this, float delta_time) {
+    cs_player_update(_this, delta_time);
+
+    auto main_player = er::CS::WorldChrManImp::instance()->main_player;
+
+    // This runs for every player every frame, so only read the clock if something records it
+    if (!erdyes::config::telemetry && !erdyes::trace::enabled) {
+        update_player(_this, main_player, delta_time);
+        return;
+    }
+
+    auto start_time = chrono::steady_clock::now();
+    update_player(_this, main_player, delta_time);
+    auto end_time = chrono::steady_clock::now();
+
+    if (erdyes::trace::enabled) {
+        erdyes::trace::record(_this == main_player ? "PlayerIns::Update (main player)"
+                                                   : "PlayerIns::Update",
+                              start_time, end_time);
+    }
+
+    if (erdyes::config::telemetry) {
+        auto elapsed = end_time - start_time;
+        erdyes::telemetry::add(erdyes::telemetry::counters->player_update_calls);
+        erdyes::telemetry::add(erdyes::telemetry::counters->player_update_ns,
+                               chrono::duration_cast<chrono::nanoseconds>(elapsed).count());
+    }
+}
+
 /**
  * Updates all material parameters for the given character based on the given selected colors
  */
 static void apply_colors(er::CS::ChrIns *chr, const erdyes::state::dye_values &values) {
-    auto apply_color = [&](const wstring &name, const erdyes::state::dye_value &value) {
-        auto new_modifier = er::CS::CSChrModelParamModifierModule::modifier{
+    typedef er::CS::CSChrModelParamModifierModule::modifier modifier_type;
+
+    // Prepare all of the tint modifiers for this character up front in one contiguous block
+    alignas(16) array<modifier_type, erdyes::max_tint_modifiers> new_modifiers;
+    array<const wstring *, erdyes::max_tint_modifiers> new_modifier_names;
+    size_t count = 0;
+
+    auto add_modifier = [&](const wstring &name, const erdyes::state::dye_value &value) {
+        // Animated dyes are sampled once per frame, so just read the current color
+        auto rgb = value.animation_index != -1
+                       ? erdyes::animated_dyes::get_current(value.animation_index)
+                       : erdyes::animated_dyes::rgb{value.red, value.green, value.blue};
+
+        new_modifier_names[count] = &name;
+        new_modifiers[count++] = modifier_type{
             .name = name.data(),
             .value = {.material_id = 1,
-                      .value1 = value.red,
-                      .value2 = value.green,
-                      .value3 = value.blue,
+                      .value1 = rgb[0],
+                      .value2 = rgb[1],
+                      .value3 = rgb[2],
                       .value4 = 1.0f,
                       .value5 = value.intensity},
         };
-
-        auto &modifiers = chr->modules->model_param_modifier_module->modifiers;
-
-        // Update the modifier if it's already applied to the character, otherwise insert it
-        // into the vector. Note that we write over the entire modifier and not just the RGB
-        // fields because the game zeros out this memory each frame.
-        for (auto &modifier : modifiers) {
-            if (modifier.name == name) {
-                modifier = new_modifier;
-                return;
-            }
-        }
-
-        modifiers.push_back(new_modifier);
     };
 
     if (values.primary.is_applied) {
         // Albedo 1 typically controls the largest portion of armor and weapon models
-        apply_color(albedo1_material_ex_name, values.primary);
+        add_modifier(albedo1_material_ex_name, values.primary);
     }
     if (values.secondary.is_applied) {
         // Albedo 3 typically controls secondary materials and accents
-        apply_color(albedo3_material_ex_name, values.secondary);
+        add_modifier(albedo3_material_ex_name, values.secondary);
     }
     if (values.tertiary.is_applied) {
         // Albedo 2 and 4 are both used less commonly for small details, so group them both in as
         // the "tertiary" color
-        apply_color(albedo2_material_ex_name, values.tertiary);
-        apply_color(albedo4_material_ex_name, values.tertiary);
+        add_modifier(albedo2_material_ex_name, values.tertiary);
+        add_modifier(albedo4_material_ex_name, values.tertiary);
     }
+
+    if (count == 0) {
+        return;
+    }
+
+    // Update any modifiers that are already applied to the character, and insert the rest
+    erdyes::write_modifiers(chr->modules->model_param_modifier_module->modifiers, new_modifiers,
+                            new_modifier_names, count);
 }
 
 static void (*copy_player_character_data)(er::CS::PlayerIns *, er::CS::PlayerIns *);
@@ -142,12 +320,16 @@ static void copy_player_character_data_detour(er::CS::PlayerIns *target,
                                               er::CS::PlayerIns *source) {
     copy_player_character_data(target, source);
 
-    // When a player character is copied onto an NPC (Mimic Tear), store a number in the ChrAsm to
-    // make sure dyes also apply to the mimic.
+    erdyes::trace::scope trace_scope{"copy_player_character_data"};
+
+    // When a player character is copied onto an NPC (Mimic Tear), remember which player it was
+    // copied from to make sure dyes also apply to the mimic.
     auto world_chr_man = er::CS::WorldChrManImp::instance();
     if (world_chr_man && source == world_chr_man->main_player) {
-        auto &chr_asm = target->game_data->equip_game_data.chr_asm;
-        chr_asm.gear_param_ids.unused4 = player_copy_sentinel;
+        erdyes::chr_dyes::assign(target, erdyes::chr_dyes::dye_source::local_player);
+    } else if (auto network_session = source->session_holder.network_session) {
+        erdyes::chr_dyes::assign(target, erdyes::chr_dyes::dye_source::net_player,
+                                 network_session->steam_id);
     }
 }
 
@@ -0,0 +1,221 @@
+/**
+ * erdyes_capture.cpp
+ *
+ * Optional recording of the inputs the mod consumes each frame, so sessions that can't be
+ * reproduced, such as a large co-op session with a hitch, can be replayed off the game. Records are
+ * appended to a buffer in memory, and full buffers are written to the file on a separate thread so
+ * the game thread never waits on the disk.
+ */
+#include "erdyes_capture.hpp"
+#include "erdyes_capture_format.hpp"
+#include "erdyes_local_player.hpp"
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace erdyes::capture;
+
+// Buffers are handed to the writer thread once they're this large
+static constexpr size_t flush_size = 64 * 1024;
+
+// Records not handed to the writer thread yet. This is locked since messages are recorded from the
+// network thread.
+static mutex buffer_mutex;
+static vector<unsigned char> buffer;
+static bool is_started = false;
+
+// Full buffers waiting to be written by the writer thread
+static mutex writer_mutex;
+static condition_variable writer_condition;
+static vector<vector<unsigned char>> pending_buffers;
+static bool stop_writer = false;
+static thread writer_thread;
+
+static ofstream output;
+
+template <typename T>
+static void append(const T &value) {
+    auto bytes = reinterpret_cast<const unsigned char *>(&value);
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+static void append_type(record_type type) {
+    append(static_cast<unsigned char>(type));
+}
+
+/**
+ * Write full buffers to the file until deinit() is called. This runs on the writer thread.
+ */
+static void write_buffers() {
+    auto lock = unique_lock{writer_mutex};
+    for (;;) {
+        writer_condition.wait(lock, [] { return stop_writer || !pending_buffers.empty(); });
+        auto buffers = move(pending_buffers);
+        pending_buffers.clear();
+        auto is_stopping = stop_writer;
+        lock.unlock();
+
+        for (auto &full_buffer : buffers) {
+            output.write(reinterpret_cast<const char *>(full_buffer.data()), full_buffer.size());
+        }
+
+        if (is_stopping) {
+            return;
+        }
+        lock.lock();
+    }
+}
+
+void erdyes::capture::init(const filesystem::path &output_path) {
+    output.open(output_path, ios::binary | ios::trunc);
+    if (!output) {
+        spdlog::error("Failed to open {}", output_path.string());
+        return;
+    }
+
+    buffer.reserve(2 * flush_size);
+    writer_thread = thread(write_buffers);
+    enabled = true;
+    spdlog::info("Capturing inputs to {}", output_path.string());
+}
+
+void erdyes::capture::deinit() {
+    if (!enabled) {
+        return;
+    }
+
+    {
+        auto lock = lock_guard{buffer_mutex};
+        auto writer_lock = lock_guard{writer_mutex};
+        pending_buffers.push_back(move(buffer));
+        stop_writer = true;
+    }
+    writer_condition.notify_one();
+    writer_thread.join();
+
+    output.close();
+    if (output.fail()) {
+        spdlog::error("Failed to write captured inputs");
+    }
+}
+
+void erdyes::capture::record_frame(float delta_time) {
+    auto lock = unique_lock{buffer_mutex};
+
+    if (!is_started) {
+        append(capture_magic);
+        append(capture_version);
+        append(static_cast<unsigned int>(erdyes::colors.size()));
+        append(static_cast<unsigned int>(erdyes::intensities.size()));
+        for (auto &color : erdyes::colors) {
+            append(color.red);
+            append(color.green);
+            append(color.blue);
+            append(color.animation_id);
+        }
+        for (auto &intensity : erdyes::intensities) {
+            append(intensity.intensity);
+        }
+        is_started = true;
+    }
+
+    if (buffer.size() >= flush_size) {
+        auto full_buffer = move(buffer);
+        buffer = {};
+        buffer.reserve(2 * flush_size);
+        lock.unlock();
+
+        {
+            auto writer_lock = lock_guard{writer_mutex};
+            pending_buffers.push_back(move(full_buffer));
+        }
+        writer_condition.notify_one();
+
+        lock.lock();
+    }
+
+    append_type(record_type::frame);
+    append(delta_time);
+}
+
+void erdyes::capture::record_local_indices(const array<int, 6> &indices) {
+    static array<int, 6> last_indices;
+    static bool has_last_indices = false;
+
+    auto lock = lock_guard{buffer_mutex};
+    if (!is_started || (has_last_indices && indices == last_indices)) {
+        return;
+    }
+    last_indices = indices;
+    has_last_indices = true;
+
+    append_type(record_type::local_indices);
+    for (auto index : indices) {
+        append(static_cast<short>(index));
+    }
+}
+
+void erdyes::capture::record_focused_entry(int focused_entry) {
+    static int last_focused_entry;
+    static bool has_last_focused_entry = false;
+
+    auto lock = lock_guard{buffer_mutex};
+    if (!is_started || (has_last_focused_entry && focused_entry == last_focused_entry)) {
+        return;
+    }
+    last_focused_entry = focused_entry;
+    has_last_focused_entry = true;
+
+    append_type(record_type::focused_entry);
+    append(focused_entry);
+}
+
+void erdyes::capture::record_message(unsigned long long steam_id,
+                                     span<const unsigned char> message) {
+    auto lock = lock_guard{buffer_mutex};
+
+    // Nothing is recorded until the first frame saves the palette
+    if (!is_started) {
+        return;
+    }
+
+    // Messages this large are never valid, so a truncated one still replays as a rejected message
+    auto size = static_cast<unsigned short>(min<size_t>(message.size(), 0xffff));
+
+    append_type(record_type::message);
+    append(steam_id);
+    append(size);
+    buffer.insert(buffer.end(), message.begin(), message.begin() + size);
+}
+
+void erdyes::capture::record_session(span<const unsigned long long> steam_ids) {
+    auto count = static_cast<unsigned short>(min<size_t>(steam_ids.size(), 0xffff));
+
+    auto lock = lock_guard{buffer_mutex};
+    if (!is_started) {
+        return;
+    }
+
+    append_type(record_type::session);
+    append(count);
+    for (auto steam_id : steam_ids.first(count)) {
+        append(steam_id);
+    }
+}
+
+void erdyes::capture::record_character(unsigned long long steam_id, size_t modifier_count) {
+    auto lock = lock_guard{buffer_mutex};
+    if (!is_started) {
+        return;
+    }
+
+    append_type(record_type::character);
+    append(steam_id);
+    append(static_cast<unsigned short>(min<size_t>(modifier_count, 0xffff)));
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <filesystem>
+#include <span>
+
+namespace erdyes {
+namespace capture {
+
+// Set by init() if capturing is turned on in the config
+inline bool enabled = false;
+
+/**
+ * Start recording the inputs the mod consumes each frame to the given path, so a session can be
+ * replayed off the game with erdyes_replay. The format is described in erdyes_capture_format.hpp.
+ */
+void init(const std::filesystem::path &output_path);
+
+/**
+ * Write any records that haven't been saved yet and close the file
+ */
+void deinit();
+
+/**
+ * Start a new frame. This is called once per main player update, before anything else is recorded
+ * for the frame. The palette is saved along with the first frame, since it's loaded by then.
+ */
+void record_frame(float delta_time);
+
+/**
+ * Record the local player's selected indices, if they changed
+ */
+void record_local_indices(const std::array<int, 6> &indices);
+
+/**
+ * Record the focused talkscript menu entry, if it changed
+ */
+void record_focused_entry(int focused_entry);
+
+/**
+ * Record a message received from another player. This is called from the network thread.
+ */
+void record_message(unsigned long long steam_id, std::span<const unsigned char> message);
+
+/**
+ * Record the Steam IDs of the players in the session
+ */
+void record_session(std::span<const unsigned long long> steam_ids);
+
+/**
+ * Record dyes being applied to a character, from the player with the given Steam ID or 0 for the
+ * local player
+ */
+void record_character(unsigned long long steam_id, size_t modifier_count);
+
+}
+}
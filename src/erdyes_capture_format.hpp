@@ -0,0 +1,181 @@
+#pragma once
+
+#include "erdyes_palette.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <vector>
+
+namespace erdyes {
+namespace capture {
+
+static constexpr unsigned int capture_magic = 0x50414345;  // "ECAP"
+
+// Increased whenever the header or a record changes
+static constexpr unsigned int capture_version = 1;
+
+/**
+ * A capture file starts with a header and the local palette, followed by records of the inputs the
+ * mod consumed, in the order it consumed them. Each record is a type byte followed by its fields,
+ * packed without padding in native byte order:
+ *
+ *   header         u32 magic, u32 version, u32 color count, u32 intensity count,
+ *                  (f32 red, f32 green, f32 blue, u32 animation ID) per color,
+ *                  f32 intensity per intensity
+ *   frame          f32 delta time, starting a main player update
+ *   local_indices  i16 selected index of each dye target, when they change
+ *   focused_entry  i32 focused talkscript menu entry, when it changes
+ *   message        u64 sender Steam ID, u16 size, message bytes, for each received message
+ *   session        u16 count, u64 Steam ID of each player in the session
+ *   character      u64 Steam ID of the player whose dyes are applied, or 0 for the local player,
+ *                  u16 size of the character's modifier vector before they're applied
+ */
+enum class record_type : unsigned char {
+    frame,
+    local_indices,
+    focused_entry,
+    message,
+    session,
+    character,
+};
+
+// Steam IDs in a session record are kept as bytes, since they aren't aligned
+struct record {
+    record_type type;
+    float delta_time;
+    std::array<int, 6> indices;
+    int focused_entry;
+    unsigned long long steam_id;
+    unsigned int modifier_count;
+    std::span<const unsigned char> message;
+    std::span<const unsigned char> session_steam_ids;
+
+    size_t get_session_size() const { return session_steam_ids.size() / sizeof(steam_id); }
+
+    unsigned long long get_session_steam_id(size_t i) const {
+        unsigned long long result;
+        memcpy(&result, session_steam_ids.data() + i * sizeof(result), sizeof(result));
+        return result;
+    }
+};
+
+/**
+ * Reads a capture file, which comes from another player and isn't trusted
+ */
+class reader {
+public:
+    explicit reader(std::span<const unsigned char> data) : data(data) {}
+
+    /**
+     * Read the header and the palette the capture was recorded with. Animated colors are read as
+     * static colors, but keep their animation IDs so the palette hash still matches.
+     *
+     * @returns false if the data isn't a capture file from this version of the mod
+     */
+    bool read_header(std::vector<erdyes::color> &colors,
+                     std::vector<erdyes::intensity> &intensities) {
+        unsigned int magic, version, color_count, intensity_count;
+        if (!read(magic) || !read(version) || magic != capture_magic ||
+            version != capture_version || !read(color_count) || !read(intensity_count)) {
+            return false;
+        }
+
+        // Each color takes 16 bytes, so a count larger than the rest of the file is invalid
+        if (color_count > data.size() / 16 || intensity_count > data.size() / 4) {
+            return false;
+        }
+
+        colors.resize(color_count);
+        for (auto &color : colors) {
+            color.animation_index = -1;
+            if (!read(color.red) || !read(color.green) || !read(color.blue) ||
+                !read(color.animation_id)) {
+                return false;
+            }
+        }
+
+        intensities.resize(intensity_count);
+        for (auto &intensity : intensities) {
+            if (!read(intensity.intensity)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * Read the next record after the header
+     *
+     * @returns false at the end of the file, or if the next record is invalid or cut off
+     */
+    bool next(record &result) {
+        unsigned char type;
+        if (!read(type)) {
+            return false;
+        }
+
+        result.type = static_cast<record_type>(type);
+        switch (result.type) {
+            case record_type::frame:
+                return read(result.delta_time);
+            case record_type::local_indices:
+                for (auto &index : result.indices) {
+                    short value;
+                    if (!read(value)) {
+                        return false;
+                    }
+                    index = value;
+                }
+                return true;
+            case record_type::focused_entry:
+                return read(result.focused_entry);
+            case record_type::message: {
+                unsigned short size;
+                return read(result.steam_id) && read(size) && read_bytes(size, result.message);
+            }
+            case record_type::session: {
+                unsigned short count;
+                return read(count) &&
+                       read_bytes(count * sizeof(result.steam_id), result.session_steam_ids);
+            }
+            case record_type::character: {
+                unsigned short modifier_count;
+                if (!read(result.steam_id) || !read(modifier_count)) {
+                    return false;
+                }
+                result.modifier_count = modifier_count;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+private:
+    std::span<const unsigned char> data;
+
+    template <typename T>
+    bool read(T &value) {
+        if (data.size() < sizeof(T)) {
+            return false;
+        }
+        memcpy(&value, data.data(), sizeof(T));
+        data = data.subspan(sizeof(T));
+        return true;
+    }
+
+    bool read_bytes(size_t size, std::span<const unsigned char> &bytes) {
+        if (data.size() < size) {
+            return false;
+        }
+        bytes = data.first(size);
+        data = data.subspan(size);
+        return true;
+    }
+};
+
+}
+}
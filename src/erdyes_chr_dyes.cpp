@@ -0,0 +1,143 @@
+/**
+ * erdyes_chr_dyes.cpp
+ *
+ * Flat hash table of dye assignments for characters that copy a player, such as Mimic Tears
+ */
+#include "erdyes_chr_dyes.hpp"
+#include "erdyes_scheduler.hpp"
+#include "erdyes_trace.hpp"
+
+#include <spdlog/spdlog.h>
+#include <array>
+
+using namespace std;
+
+// Number of main player updates after which an assignment for a character that's no longer being
+// updated is considered despawned
+static constexpr unsigned int expire_frames = 30;
+
+// How often to rebuild the table to clear out expired entries, which otherwise slow down probing
+static constexpr unsigned int rebuild_interval_frames = 60;
+
+struct chr_dyes_entry {
+    er::CS::PlayerIns *chr{nullptr};
+    int generation{0};
+    unsigned int last_seen_frame{0};
+    erdyes::chr_dyes::assignment assignment;
+};
+
+static array<chr_dyes_entry, 128> entries;
+static unsigned int current_frame = 0;
+
+// Each assignment stamps a new generation number into an unused field of the character's ChrAsm,
+// which the game resets when it creates a character. This tells a new character allocated at the
+// same address as a despawned one apart from the character that was assigned.
+static int next_generation = 1;
+
+static auto &get_generation_field(er::CS::PlayerIns *chr) {
+    return chr->game_data->equip_game_data.chr_asm.gear_param_ids.unused4;
+}
+
+static size_t get_start_index(er::CS::PlayerIns *chr) {
+    return (reinterpret_cast<uintptr_t>(chr) >> 4) % entries.size();
+}
+
+static bool is_expired(const chr_dyes_entry &entry) {
+    return current_frame - entry.last_seen_frame > expire_frames;
+}
+
+void erdyes::chr_dyes::assign(er::CS::PlayerIns *chr,
+                              dye_source source,
+                              unsigned long long steam_id) {
+    chr_dyes_entry *reusable_entry = nullptr;
+
+    for (size_t i = 0, index = get_start_index(chr); i < entries.size();
+         i++, index = (index + 1) % entries.size()) {
+        auto &entry = entries[index];
+        if (entry.chr == chr) {
+            reusable_entry = &entry;
+            break;
+        }
+        if (entry.chr == nullptr) {
+            if (!reusable_entry) reusable_entry = &entry;
+            break;
+        }
+        if (!reusable_entry && is_expired(entry)) {
+            reusable_entry = &entry;
+        }
+    }
+
+    if (!reusable_entry) {
+        spdlog::warn("Can't assign dyes to character {}, too many copies", (void *)chr);
+        return;
+    }
+
+    // Keep generations positive if the counter ever wraps around, so a stamp is never 0 or -1
+    if (next_generation <= 0) {
+        next_generation = 1;
+    }
+    auto generation = next_generation++;
+    get_generation_field(chr) = generation;
+
+    *reusable_entry = {
+        .chr = chr,
+        .generation = generation,
+        .last_seen_frame = current_frame,
+        .assignment = {.source = source, .steam_id = steam_id},
+    };
+}
+
+erdyes::chr_dyes::assignment *erdyes::chr_dyes::find(er::CS::PlayerIns *chr) {
+    for (size_t i = 0, index = get_start_index(chr); i < entries.size();
+         i++, index = (index + 1) % entries.size()) {
+        auto &entry = entries[index];
+        if (entry.chr == chr) {
+            if (is_expired(entry)) {
+                return nullptr;
+            }
+
+            // The assigned character despawned and a different one was created at its address.
+            // Expire the entry so it's reused or dropped by the next rebuild.
+            if (get_generation_field(chr) != entry.generation) {
+                entry.last_seen_frame = current_frame - expire_frames - 1;
+                return nullptr;
+            }
+
+            entry.last_seen_frame = current_frame;
+            return &entry.assignment;
+        }
+        if (entry.chr == nullptr) {
+            return nullptr;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * Reinsert every live entry into a fresh table, dropping characters that have despawned
+ */
+static void rebuild() {
+    erdyes::trace::scope trace_scope{"chr_dyes::rebuild"};
+
+    auto old_entries = entries;
+    entries.fill({});
+    for (auto &old_entry : old_entries) {
+        if (old_entry.chr == nullptr || is_expired(old_entry)) {
+            continue;
+        }
+
+        auto index = get_start_index(old_entry.chr);
+        while (entries[index].chr != nullptr) {
+            index = (index + 1) % entries.size();
+        }
+        entries[index] = old_entry;
+    }
+}
+
+void erdyes::chr_dyes::next_frame() {
+    current_frame++;
+
+    if (current_frame % rebuild_interval_frames == 0) {
+        erdyes::scheduler::post(rebuild);
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <elden-x/chr/world_chr_man.hpp>
+
+namespace erdyes {
+namespace chr_dyes {
+
+enum class dye_source : unsigned char {
+    none,
+    local_player,
+    net_player,
+};
+
+/**
+ * Where a character other than the main player or a networked player gets its dyes from, for
+ * example a Mimic Tear copying one of the players
+ */
+struct assignment {
+    dye_source source{dye_source::none};
+    // Steam ID of the copied player, for net_player assignments
+    unsigned long long steam_id{0};
+    // Last net_players slot found for steam_id, used as a hint for the next lookup
+    int net_slot{-1};
+};
+
+/**
+ * Assign dyes from the given source to a character. Assignments are dropped automatically once the
+ * character stops being updated, or if a different character is created at the same address.
+ */
+void assign(er::CS::PlayerIns *, dye_source, unsigned long long steam_id = 0);
+
+/**
+ * @returns the dye assignment for the given character, or nullptr if it doesn't have one
+ */
+assignment *find(er::CS::PlayerIns *);
+
+/**
+ * Advance the frame counter used to expire assignments for characters that have despawned. This
+ * should be called once per main player update.
+ */
+void next_frame();
+
+}
+}
@@ -0,0 +1,60 @@
+#include "erdyes_color_parsing.hpp"
+
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+bool erdyes::parse_animated_dye(const string &str,
+                                vector<erdyes::animated_dyes::rgb> &keyframes,
+                                float &period,
+                                string &display_hex_code) {
+    auto tokens = vector<string>{};
+    auto stream = istringstream{str};
+    for (string token; stream >> token;) {
+        tokens.push_back(token);
+    }
+
+    if (tokens.size() < 2) {
+        return false;
+    }
+
+    try {
+        size_t end;
+        period = stof(tokens.back(), &end);
+        if (end != tokens.back().size() || !(period > 0.0f)) {
+            return false;
+        }
+    } catch (logic_error const &) {
+        return false;
+    }
+    tokens.pop_back();
+
+    if (tokens.size() == 1 && tokens[0] == "rainbow") {
+        display_hex_code = "#ff0000";
+        return true;
+    }
+
+    if (tokens.size() < 2) {
+        return false;
+    }
+
+    for (auto &token : tokens) {
+        int elements[3];
+        if (!parse_hex_code(token, elements)) {
+            return false;
+        }
+        keyframes.push_back({elements[0] / 255.0f, elements[1] / 255.0f, elements[2] / 255.0f});
+    }
+
+    display_hex_code = tokens[0];
+    return true;
+}
+
+unsigned int erdyes::hash_string(const string &str) {
+    unsigned int hash = 2166136261u;
+    for (auto chr : str) {
+        hash = (hash ^ static_cast<unsigned char>(chr)) * 16777619u;
+    }
+    return hash == 0 ? 1 : hash;
+}
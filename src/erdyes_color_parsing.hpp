@@ -0,0 +1,62 @@
+#pragma once
+
+#include "erdyes_animated_dyes.hpp"
+
+#include <string>
+#include <vector>
+
+namespace erdyes {
+
+/**
+ * Parse an HTML-style hexadecimal color code, returning true if successful
+ */
+template <typename string_type>
+constexpr bool parse_hex_code(const string_type &str, int elements[3]) {
+    if (str.empty() || str[0] != '#' || (str.size() != 4 && str.size() != 7)) {
+        return false;
+    }
+
+    int digits[6] = {};
+    for (size_t i = 1; i < str.size(); ++i) {
+        auto chr = str[i];
+        auto &digit = digits[i - 1];
+
+        if (chr >= '0' && chr <= '9')
+            digit = chr - '0';
+        else if (chr >= 'A' && chr <= 'F')
+            digit = 0xa + chr - 'A';
+        else if (chr >= 'a' && chr <= 'f')
+            digit = 0xa + chr - 'a';
+        else
+            return false;
+    }
+
+    if (str.size() == 4) {
+        elements[0] = digits[0] * 0x11;
+        elements[1] = digits[1] * 0x11;
+        elements[2] = digits[2] * 0x11;
+    } else {
+        elements[0] = digits[0] * 0x10 + digits[1];
+        elements[1] = digits[2] * 0x10 + digits[3];
+        elements[2] = digits[4] * 0x10 + digits[5];
+    }
+
+    return true;
+}
+
+/**
+ * Parse an animated color definition, which is either a list of hex codes followed by a period in
+ * seconds (e.g. "#ff0000 #0000ff 2.5"), or "rainbow" followed by a period. Returns true if
+ * successful, and outputs the hex code to show in the menu.
+ */
+bool parse_animated_dye(const std::string &str,
+                        std::vector<erdyes::animated_dyes::rgb> &keyframes,
+                        float &period,
+                        std::string &display_hex_code);
+
+/**
+ * 32-bit FNV-1a hash, used to identify animated dyes across the network
+ */
+unsigned int hash_string(const std::string &str);
+
+}
@@ -1,12 +1,23 @@
 #define MINI_CASE_SENSITIVE
 
 #include "erdyes_config.hpp"
+#include "erdyes_animated_dyes.hpp"
+#include "erdyes_color_parsing.hpp"
+#include "erdyes_ini_settings.hpp"
 #include "erdyes_local_player.hpp"
+#include "erdyes_palette_cache.hpp"
 
 #include <mini/ini.h>
 #include <spdlog/spdlog.h>
+#include <algorithm>
 #include <codecvt>
+#include <fstream>
+#include <iterator>
 #include <locale>
+#include <array>
+#include <string_view>
+#include <type_traits>
+#include <vector>
 
 using namespace std;
 
@@ -20,52 +31,103 @@ unsigned int erdyes::config::initialize_delay = 5000;
 
 bool erdyes::config::client_side_only = false;
 
-/**
- * Parse an HTML-style hexadecimal color code, returning true if successful
- */
-static bool parse_hex_code(const string &str, int elements[3]) {
-    if (str[0] != '#' || (str.size() != 4 && str.size() != 7)) {
-        return false;
-    }
+bool erdyes::config::cache_palette = false;
 
-    int digits[6];
-    for (int i = 1; i < str.size(); ++i) {
-        auto chr = str[i];
-        auto &digit = digits[i - 1];
-
-        if (chr >= '0' && chr <= '9')
-            digit = chr - '0';
-        else if (chr >= 'A' && chr <= 'F')
-            digit = 0xa + chr - 'A';
-        else if (chr >= 'a' && chr <= 'f')
-            digit = 0xa + chr - 'a';
-        else
-            return false;
+bool erdyes::config::match_palette = false;
+
+bool erdyes::config::telemetry = false;
+
+bool erdyes::config::trace = false;
+
+bool erdyes::config::capture = false;
+
+int erdyes::config::intensity_count = 10;
+float erdyes::config::intensity_min = 0.125f;
+float erdyes::config::intensity_max = 64.0f;
+bool erdyes::config::intensity_exponential = true;
+
+float erdyes::config::cull_distance = 0.0f;
+
+// Intensity options are stored in ranges of dummy goods and message IDs, so there's a limit
+static constexpr int max_intensity_count = 100;
+
+struct default_color {
+    const wchar_t *name;
+    const wchar_t *hex_code;
+    float red;
+    float green;
+    float blue;
+};
+
+static consteval default_color make_default_color(const wchar_t *name, const wchar_t *hex_code) {
+    int elements[3] = {};
+    if (!erdyes::parse_hex_code(wstring_view{hex_code}, elements)) {
+        throw "Invalid default color";
     }
+    return {name, hex_code, elements[0] / 255.0f, elements[1] / 255.0f, elements[2] / 255.0f};
+}
+
+// Colors used if the .ini file doesn't define any, parsed at compile time
+static constexpr auto default_colors = array{
+    make_default_color(L"Mountaintop White", L"#f9fffe"),
+    make_default_color(L"Stormhill Gray", L"#9d9d97"),
+    make_default_color(L"Vagabond Steel", L"#474f52"),
+    make_default_color(L"Deathbed Atrous", L"#1d1d21"),
+    make_default_color(L"Crucible Bronze", L"#835432"),
+    make_default_color(L"Crimson Amber", L"#b02e26"),
+    make_default_color(L"Roiling Magma", L"#f9801d"),
+    make_default_color(L"Xanthous Frenzy", L"#fed83d"),
+    make_default_color(L"Toxic Chartreuse", L"#80c71f"),
+    make_default_color(L"Cave Moss Green", L"#5e7c16"),
+    make_default_color(L"Cerulean Amber", L"#169c9c"),
+    make_default_color(L"Primeval Blue", L"#3c44aa"),
+    make_default_color(L"Violet Void", L"#8932b8"),
+    make_default_color(L"Madding Magenta", L"#c74ebd"),
+    make_default_color(L"Putrid Pink", L"#f38baa"),
+};
 
-    if (str.size() == 4) {
-        elements[0] = digits[0] * 0x11;
-        elements[1] = digits[1] * 0x11;
-        elements[2] = digits[2] * 0x11;
-    } else {
-        elements[0] = digits[0] * 0x10 + digits[1];
-        elements[1] = digits[2] * 0x10 + digits[3];
-        elements[2] = digits[4] * 0x10 + digits[5];
+static void add_default_colors() {
+    erdyes::colors.reserve(default_colors.size());
+    for (auto &color : default_colors) {
+        erdyes::local_player::add_color_option(color.name, color.hex_code, color.red, color.green,
+                                               color.blue);
     }
 
-    return true;
+    spdlog::info("Added {} default colors", erdyes::colors.size());
+}
+
+/**
+ * Parse a number from the .ini file, keeping the default value if it's invalid
+ */
+template <typename T>
+static void parse_number(const string &key, const string &str, T &result) {
+    try {
+        if constexpr (is_floating_point_v<T>)
+            result = stof(str);
+        else
+            result = static_cast<T>(stoi(str, nullptr, 10));
+    } catch (logic_error const &) {
+        spdlog::error("Invalid value for {}: \"{}\"", key, str);
+    }
 }
 
 void erdyes::load_config(const filesystem::path &ini_path) {
     spdlog::info("Loading config from {}", ini_path.string());
 
-    mINI::INIFile file(ini_path.string());
-
-    mINI::INIStructure ini;
-    if (!file.read(ini)) {
+    auto ini_stream = ifstream{ini_path, ios::binary};
+    if (!ini_stream) {
         spdlog::warn("Failed to read config");
+        add_default_colors();
         return;
     }
+    auto ini_text = string{istreambuf_iterator<char>{ini_stream}, istreambuf_iterator<char>{}};
+
+    // Read the settings first, and only parse the colors if they aren't in the palette cache
+    mINI::INIStructure ini;
+    auto has_colors = erdyes::read_ini_settings(
+        ini_text, [&](string_view section, string_view key, string_view value) {
+            ini[string{section}][string{key}] = value;
+        });
 
     if (ini.has("erdyes")) {
         auto &erdyes_config = ini["erdyes"];
@@ -74,13 +136,80 @@ void erdyes::load_config(const filesystem::path &ini_path) {
             erdyes::config::debug = true;
 
         if (erdyes_config.has("initialize_delay"))
-            erdyes::config::initialize_delay = stoi(erdyes_config["initialize_delay"], nullptr, 10);
+            parse_number("initialize_delay", erdyes_config["initialize_delay"],
+                         erdyes::config::initialize_delay);
 
         if (erdyes_config.has("client_side_only"))
             erdyes::config::client_side_only = erdyes_config["client_side_only"] != "false";
+
+        if (erdyes_config.has("cache_palette"))
+            erdyes::config::cache_palette = erdyes_config["cache_palette"] != "false";
+
+        if (erdyes_config.has("match_palette"))
+            erdyes::config::match_palette = erdyes_config["match_palette"] != "false";
+
+        if (erdyes_config.has("telemetry"))
+            erdyes::config::telemetry = erdyes_config["telemetry"] != "false";
+
+        if (erdyes_config.has("trace"))
+            erdyes::config::trace = erdyes_config["trace"] != "false";
+
+        if (erdyes_config.has("capture"))
+            erdyes::config::capture = erdyes_config["capture"] != "false";
+
+        if (erdyes_config.has("cull_distance"))
+            parse_number("cull_distance", erdyes_config["cull_distance"],
+                         erdyes::config::cull_distance);
+    }
+
+    if (ini.has("intensity")) {
+        auto &intensity_config = ini["intensity"];
+
+        if (intensity_config.has("count"))
+            parse_number("count", intensity_config["count"], erdyes::config::intensity_count);
+
+        if (intensity_config.has("min"))
+            parse_number("min", intensity_config["min"], erdyes::config::intensity_min);
+
+        if (intensity_config.has("max"))
+            parse_number("max", intensity_config["max"], erdyes::config::intensity_max);
+
+        if (intensity_config.has("curve"))
+            erdyes::config::intensity_exponential = intensity_config["curve"] != "linear";
+
+        if (erdyes::config::intensity_count < 1 ||
+            erdyes::config::intensity_count > max_intensity_count) {
+            spdlog::error("Invalid intensity count {}, must be between 1 and {}",
+                          erdyes::config::intensity_count, max_intensity_count);
+            erdyes::config::intensity_count = clamp(erdyes::config::intensity_count, 1,
+                                                    max_intensity_count);
+        }
+
+        if (!(erdyes::config::intensity_min > 0.0f) ||
+            !(erdyes::config::intensity_max >= erdyes::config::intensity_min)) {
+            spdlog::error("Invalid intensity range {} - {}, using defaults",
+                          erdyes::config::intensity_min, erdyes::config::intensity_max);
+            erdyes::config::intensity_min = 0.125f;
+            erdyes::config::intensity_max = 64.0f;
+        }
+    }
+
+    // Hash the whole .ini file and mod version, so any change invalidates the palette cache
+    auto cache_path = ini_path.parent_path() / "erdyes_palette.bin";
+    auto config_hash = 0u;
+    if (erdyes::config::cache_palette) {
+#ifdef PROJECT_VERSION
+        ini_text += PROJECT_VERSION;
+#endif
+        config_hash = erdyes::hash_string(ini_text);
     }
 
-    if (ini.has("colors")) {
+    mINI::INIFile file(ini_path.string());
+
+    if (erdyes::config::cache_palette && has_colors &&
+        erdyes::palette_cache::load(cache_path, config_hash)) {
+        spdlog::info("Loaded {} colors from palette cache", erdyes::colors.size());
+    } else if (has_colors && file.read(ini)) {
         auto &colors_config = ini["colors"];
 
         auto converter = wstring_convert<codecvt_utf8_utf16<wchar_t>>{};
@@ -88,17 +217,40 @@ void erdyes::load_config(const filesystem::path &ini_path) {
         erdyes::colors.reserve(colors_config.size());
         for (auto &[name, hex_code] : colors_config) {
             int elements[3];
-            if (parse_hex_code(hex_code, elements)) {
+            vector<erdyes::animated_dyes::rgb> keyframes;
+            float period;
+            string display_hex_code;
+            if (erdyes::parse_hex_code(hex_code, elements)) {
                 erdyes::local_player::add_color_option(
                     converter.from_bytes(name), converter.from_bytes(hex_code),
                     elements[0] / 255.0f, elements[1] / 255.0f, elements[2] / 255.0f);
 
                 spdlog::info("Added color definition \"{} = {}\"", name, hex_code);
+            } else if (erdyes::parse_animated_dye(hex_code, keyframes, period, display_hex_code)) {
+                auto animation_id = erdyes::hash_string(hex_code);
+                auto animation_index =
+                    erdyes::animated_dyes::add(animation_id, keyframes, period);
+
+                // Players without the same animation see the first frame instead
+                auto &first_frame = erdyes::animated_dyes::get_current(animation_index);
+                erdyes::local_player::add_color_option(
+                    converter.from_bytes(name), converter.from_bytes(display_hex_code),
+                    first_frame[0], first_frame[1], first_frame[2], animation_id, animation_index);
+
+                spdlog::info("Added animated color definition \"{} = {}\"", name, hex_code);
             } else {
                 spdlog::error("Invalid color definition \"{} = {}\"", name, hex_code);
             }
         }
 
         spdlog::info("Added {} colors", erdyes::colors.size());
+
+        if (erdyes::config::cache_palette && !erdyes::colors.empty()) {
+            erdyes::palette_cache::save(cache_path, config_hash);
+        }
+    }
+
+    if (erdyes::colors.empty()) {
+        add_default_colors();
     }
 }
@@ -20,5 +20,34 @@ extern unsigned int initialize_delay;
 
 // Disables networking, for PVP reasons.
 extern bool client_side_only;
+
+// Save the parsed colors to a binary cache file, which is loaded instead of parsing them again
+// as long as the .ini file doesn't change
+extern bool cache_palette;
+
+// Show other players' dyes using the closest color in the local palette
+extern bool match_palette;
+
+// Number of intensity options, and the range of intensities they cover
+extern int intensity_count;
+extern float intensity_min;
+extern float intensity_max;
+
+// If true, intensity options are spaced out exponentially between intensity_min and intensity_max.
+// Otherwise they're spaced out linearly.
+extern bool intensity_exponential;
+
+// Export live counters to shared memory for overlays and monitoring tools
+extern bool telemetry;
+
+// Record a timeline of the mod's work, which is saved as a Chrome trace when F9 is pressed
+extern bool trace;
+
+// Record the inputs the mod consumes each frame, so the session can be replayed with erdyes_replay
+extern bool capture;
+
+// Characters farther than this distance from the main player don't have dyes applied. 0 disables
+// culling.
+extern float cull_distance;
 }
 };
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <array>
+
+namespace erdyes {
+namespace dummy_goods {
+
+// The dummy goods are laid out in consecutive ranges for each dye target, so checking if an ID is
+// one of them only takes a subtraction and comparison
+static constexpr int start = 6700000;
+static constexpr unsigned int range_size = 10000;
+static constexpr unsigned int range_count = 6;
+
+// Number of valid goods in each range
+typedef std::array<unsigned int, range_count> range_counts;
+
+/**
+ * @returns true if the given goods ID is one of the dummy goods. This is checked for every goods
+ * lookup in the game, so vanilla items are rejected with a single comparison. IDs below the start
+ * wrap around to large unsigned values.
+ */
+inline bool contains(int id, const range_counts &counts) {
+    auto offset = static_cast<unsigned int>(id) - static_cast<unsigned int>(start);
+    return offset < range_size * range_count && offset % range_size < counts[offset / range_size];
+}
+
+}
+}
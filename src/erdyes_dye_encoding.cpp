@@ -0,0 +1,219 @@
+/**
+ * erdyes_dye_encoding.cpp
+ *
+ * Network encoding of dye selections. Peers advertise a hash of their palette in every message, and
+ * when both peers have the same palette the selections are sent as indices. Otherwise the colors
+ * are quantized to 8 bits per channel.
+ */
+#include "erdyes_dye_encoding.hpp"
+#include "erdyes_animated_dyes.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+
+// The first byte of each message identifies its format
+static constexpr unsigned char message_type_indices = 0xd1;
+static constexpr unsigned char message_type_values = 0xd2;
+
+// The second byte is increased whenever either format changes, so messages from other versions of
+// the mod are rejected even if they happen to have the same size
+static constexpr unsigned char message_version = 1;
+
+// Type, version, palette hash, and 3 targets of (color index, intensity index)
+static constexpr size_t indices_message_size = 1 + 1 + 4 + 3 * (2 + 1);
+
+// Type, version, palette hash, and 3 targets of (is applied, red, green, blue, intensity,
+// animation ID)
+static constexpr size_t values_message_size = 1 + 1 + 4 + 3 * (1 + 3 + 4 + 4);
+
+static_assert(indices_message_size <= erdyes::dye_encoding::max_message_size);
+static_assert(values_message_size <= erdyes::dye_encoding::max_message_size);
+
+/**
+ * Helper for writing little-endian values to a message
+ */
+class message_writer {
+public:
+    message_writer(erdyes::dye_encoding::message_buffer &buffer)
+        : buffer(buffer) {}
+
+    template <typename T>
+    void write(T value) {
+        memcpy(buffer.data() + size, &value, sizeof(T));
+        size += sizeof(T);
+    }
+
+    erdyes::dye_encoding::message_buffer &buffer;
+    size_t size{0};
+};
+
+/**
+ * Helper for reading little-endian values from a message. Messages are validated by size before
+ * reading, so this doesn't do any bounds checks.
+ */
+class message_reader {
+public:
+    message_reader(span<const unsigned char> message)
+        : message(message) {}
+
+    template <typename T>
+    T read() {
+        T value;
+        memcpy(&value, message.data() + offset, sizeof(T));
+        offset += sizeof(T);
+        return value;
+    }
+
+    span<const unsigned char> message;
+    size_t offset{0};
+};
+
+unsigned int erdyes::dye_encoding::hash_palette(span<const erdyes::color> colors,
+                                                span<const erdyes::intensity> intensities) {
+    unsigned int hash = 2166136261u;
+    auto add_bytes = [&](const void *data, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ static_cast<const unsigned char *>(data)[i]) * 16777619u;
+        }
+    };
+
+    for (auto &color : colors) {
+        add_bytes(&color.red, sizeof(color.red));
+        add_bytes(&color.green, sizeof(color.green));
+        add_bytes(&color.blue, sizeof(color.blue));
+        add_bytes(&color.animation_id, sizeof(color.animation_id));
+    }
+    for (auto &intensity : intensities) {
+        add_bytes(&intensity.intensity, sizeof(intensity.intensity));
+    }
+
+    return hash;
+}
+
+size_t erdyes::dye_encoding::encode_indices(const array<int, 6> &indices,
+                                            unsigned int palette_hash,
+                                            message_buffer &buffer) {
+    auto writer = message_writer{buffer};
+    writer.write(message_type_indices);
+    writer.write(message_version);
+    writer.write(palette_hash);
+
+    auto write_target = [&](dye_target_type color_target, dye_target_type intensity_target) {
+        writer.write(static_cast<short>(indices[static_cast<int>(color_target)]));
+        writer.write(static_cast<unsigned char>(indices[static_cast<int>(intensity_target)]));
+    };
+    write_target(dye_target_type::primary_color, dye_target_type::primary_intensity);
+    write_target(dye_target_type::secondary_color, dye_target_type::secondary_intensity);
+    write_target(dye_target_type::tertiary_color, dye_target_type::tertiary_intensity);
+
+    return writer.size;
+}
+
+size_t erdyes::dye_encoding::encode_values(const erdyes::state::dye_values &values,
+                                           unsigned int palette_hash,
+                                           message_buffer &buffer) {
+    auto writer = message_writer{buffer};
+    writer.write(message_type_values);
+    writer.write(message_version);
+    writer.write(palette_hash);
+
+    auto quantize = [](float value) {
+        return static_cast<unsigned char>(clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+    };
+
+    for (auto value : {&values.primary, &values.secondary, &values.tertiary}) {
+        writer.write(static_cast<unsigned char>(value->is_applied));
+        writer.write(quantize(value->red));
+        writer.write(quantize(value->green));
+        writer.write(quantize(value->blue));
+        writer.write(value->intensity);
+        writer.write(value->animation_id);
+    }
+
+    return writer.size;
+}
+
+bool erdyes::dye_encoding::decode(span<const unsigned char> message,
+                                  unsigned int palette_hash,
+                                  span<const erdyes::color> colors,
+                                  span<const erdyes::intensity> intensities,
+                                  erdyes::state::dye_values &values,
+                                  unsigned int &sender_palette_hash) {
+    if (message.size() < 2) {
+        return false;
+    }
+
+    auto reader = message_reader{message};
+    auto message_type = reader.read<unsigned char>();
+    if (reader.read<unsigned char>() != message_version) {
+        return false;
+    }
+
+    if (message_type == message_type_indices && message.size() == indices_message_size) {
+        sender_palette_hash = reader.read<unsigned int>();
+
+        // Indices can only be decoded with the same palette they were encoded with
+        if (sender_palette_hash != palette_hash) {
+            return false;
+        }
+
+        auto decoded_values = erdyes::state::dye_values{};
+        for (auto value : {&decoded_values.primary, &decoded_values.secondary,
+                           &decoded_values.tertiary}) {
+            auto color_index = reader.read<short>();
+            auto intensity_index = reader.read<unsigned char>();
+            if (color_index < 0) {
+                continue;
+            }
+            if (static_cast<size_t>(color_index) >= colors.size() ||
+                intensity_index >= intensities.size()) {
+                return false;
+            }
+
+            auto &color = colors[color_index];
+            *value = {
+                .is_applied = true,
+                .red = color.red,
+                .green = color.green,
+                .blue = color.blue,
+                .intensity = intensities[intensity_index].intensity,
+                .animation_id = color.animation_id,
+                .animation_index = color.animation_index,
+            };
+        }
+
+        values = decoded_values;
+        return true;
+    }
+
+    if (message_type == message_type_values && message.size() == values_message_size) {
+        sender_palette_hash = reader.read<unsigned int>();
+
+        auto decoded_values = erdyes::state::dye_values{};
+        for (auto value : {&decoded_values.primary, &decoded_values.secondary,
+                           &decoded_values.tertiary}) {
+            value->is_applied = reader.read<unsigned char>() != 0;
+            value->red = reader.read<unsigned char>() / 255.0f;
+            value->green = reader.read<unsigned char>() / 255.0f;
+            value->blue = reader.read<unsigned char>() / 255.0f;
+            value->intensity = reader.read<float>();
+            value->animation_id = reader.read<unsigned int>();
+
+            // Animated dyes are sent by ID, so find the matching animation in our own config if
+            // there is one. Otherwise the static color sent along with it is shown.
+            value->animation_index = erdyes::animated_dyes::find(value->animation_id);
+
+            if (!isfinite(value->intensity)) {
+                return false;
+            }
+        }
+
+        values = decoded_values;
+        return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "erdyes_dye_values.hpp"
+#include "erdyes_palette.hpp"
+
+#include <array>
+#include <cstddef>
+#include <span>
+
+namespace erdyes {
+namespace dye_encoding {
+
+// Large enough for any encoded message
+static constexpr size_t max_message_size = 64;
+
+typedef std::array<unsigned char, max_message_size> message_buffer;
+
+/**
+ * @returns a hash of the given colors and intensities. Peers with the same hash have the same
+ * palette, so they can sync dyes by index.
+ */
+unsigned int hash_palette(std::span<const erdyes::color> colors,
+                          std::span<const erdyes::intensity> intensities);
+
+/**
+ * Encode dye selections as indices into the local palette, for a peer with the same palette
+ *
+ * @param indices selected index of each dye target, or -1 for none
+ * @returns the size of the encoded message
+ */
+size_t encode_indices(const std::array<int, 6> &indices,
+                      unsigned int palette_hash,
+                      message_buffer &buffer);
+
+/**
+ * Encode dye values as quantized colors, for a peer with a different or unknown palette
+ *
+ * @returns the size of the encoded message
+ */
+size_t encode_values(const erdyes::state::dye_values &values,
+                     unsigned int palette_hash,
+                     message_buffer &buffer);
+
+/**
+ * Decode a message created by encode_indices() or encode_values()
+ *
+ * @param palette_hash the hash of the local palette, used to decode indices
+ * @param colors the local colors, used to decode indices
+ * @param intensities the local intensities, used to decode indices
+ * @param sender_palette_hash outputs the hash of the sender's palette
+ * @returns true if the message is valid
+ */
+bool decode(std::span<const unsigned char> message,
+            unsigned int palette_hash,
+            std::span<const erdyes::color> colors,
+            std::span<const erdyes::intensity> intensities,
+            erdyes::state::dye_values &values,
+            unsigned int &sender_palette_hash);
+
+}
+}
@@ -9,6 +9,10 @@ struct dye_value {
     float green;
     float blue;
     float intensity;
+    // Network ID of the animated dye to apply instead of the RGB values, or 0 for a static color
+    unsigned int animation_id{0};
+    // Local index of the animated dye, resolved from animation_id
+    int animation_index{-1};
 };
 
 struct dye_values {
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string_view>
+
+namespace erdyes {
+
+/**
+ * Read every section of an .ini file except [colors], which can be very large, using the same
+ * rules as mINI. This lets the palette cache be checked without parsing the whole file. The
+ * callback is called with the section, key, and value of each setting, which point into the text.
+ *
+ * @returns true if the file has a [colors] section
+ */
+template <typename callback_type>
+bool read_ini_settings(std::string_view ini_text, callback_type &&add_setting) {
+    auto trim = [](std::string_view str) {
+        auto start = str.find_first_not_of(" \t\r\f\v");
+        if (start == std::string_view::npos) {
+            return std::string_view{};
+        }
+        auto end = str.find_last_not_of(" \t\r\f\v");
+        return str.substr(start, end - start + 1);
+    };
+
+    bool has_colors = false;
+    std::string_view section;
+    while (!ini_text.empty()) {
+        auto line_end = ini_text.find('\n');
+        auto line = trim(ini_text.substr(0, line_end));
+        ini_text = line_end == std::string_view::npos ? std::string_view{}
+                                                      : ini_text.substr(line_end + 1);
+
+        if (line.empty() || line[0] == ';' || line[0] == '#') {
+            continue;
+        }
+
+        if (line.front() == '[' && line.back() == ']') {
+            section = trim(line.substr(1, line.size() - 2));
+            has_colors |= section == "colors";
+            continue;
+        }
+
+        auto equals = line.find('=');
+        if (section == "colors" || equals == std::string_view::npos) {
+            continue;
+        }
+
+        add_setting(section, trim(line.substr(0, equals)), trim(line.substr(equals + 1)));
+    }
+
+    return has_colors;
+}
+
+}
@@ -5,41 +5,87 @@
  * the results to the talkscript, messages, and color application systems.
  */
 #include "erdyes_local_player.hpp"
+#include "erdyes_capture.hpp"
+#include "erdyes_config.hpp"
+#include "erdyes_dummy_goods.hpp"
 #include "erdyes_messages.hpp"
+#include "erdyes_state.hpp"
 #include "erdyes_talkscript.hpp"
+#include "erdyes_telemetry.hpp"
+#include "erdyes_trace.hpp"
 
 #include <spdlog/spdlog.h>
 #include <elden-x/chr/world_chr_man.hpp>
 #include <elden-x/paramdef/EQUIP_PARAM_GOODS_ST.hpp>
 #include <elden-x/utils/modutils.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <deque>
+#include <format>
+
 using namespace std;
 
 static constexpr unsigned int item_type_goods = 0x40000000;
 static constexpr unsigned char goods_type_hidden = 13;
 
 static constexpr int default_color_index = -1;
-static constexpr int default_intensity_index = 3;
+static int default_intensity_index = 0;
 
 // A hidden good that's saved to the player's inventory in order to persist dye settings
 static auto dummy_good = er::paramdef::equip_param_goods_st{
     .maxNum = 1,
     .goodsType = goods_type_hidden,
 };
-static constexpr int dummy_good_primary_color_start = 6700000;
+static constexpr int dummy_good_primary_color_start = erdyes::dummy_goods::start;
 static constexpr int dummy_good_secondary_color_start = 6710000;
 static constexpr int dummy_good_tertiary_color_start = 6720000;
 static constexpr int dummy_good_primary_intensity_start = 6730000;
 static constexpr int dummy_good_secondary_intensity_start = 6740000;
 static constexpr int dummy_good_tertiary_intensity_start = 6750000;
 
+// Number of valid goods in each range, filled in once all of the options are added
+static erdyes::dummy_goods::range_counts dummy_good_range_counts;
+
+// GetEquipParamGoods() calls, counted without a locked instruction and published to the telemetry
+// counters by update()
+static atomic<uint64_t> goods_lookups;
+
+static pair<int, size_t> get_dye_target_goods_range(erdyes::dye_target_type dye_target);
+
 array<wstring, 6> erdyes::dye_target_messages;
 
 vector<erdyes::color> erdyes::colors;
+
+// Menu text of the colors added with add_color_option(). A deque is used so adding more colors
+// doesn't move the existing strings.
+static deque<wstring> color_strings;
 vector<erdyes::intensity> erdyes::intensities;
 
 static erdyes::state::dye_values local_player_dyes;
 
+// Selected index for each dye target, as of the last update()
+static array<int, 6> selected_indices = {-1, -1, -1, -1, -1, -1};
+
+// Incremented by set_selected_index() to force update() to check the inventory again
+static unsigned int inventory_changes = 0;
+
+// How often update() checks the inventory even if nothing seems to have changed, in case another
+// mod or the game changes it
+static constexpr int refresh_interval_frames = 60;
+
+// Dye targets with none of their goods in the inventory as of the last full search. These aren't
+// searched again until set_selected_index() changes them, a different character or palette is
+// loaded, or every few refreshes in case another mod adds the goods.
+static array<bool, 6> known_absent = {};
+static constexpr int absent_recheck_refreshes = 10;
+
+// Recently seen selections, most recent first. This lets switching between characters restore
+// their selections without searching the inventory for every palette entry.
+static array<array<int, 6>, 12> recent_selections;
+static size_t recent_selections_count = 0;
+
 static bool is_valid_color_index(int index) { return index >= 0 && index < erdyes::colors.size(); }
 
 static bool is_valid_intensity_index(int index) {
@@ -70,18 +116,17 @@ static void (*get_equip_param_goods)(get_equip_param_goods_result *result, int i
 
 // Hook for CS::SoloParamRepositoryImp::GetEquipParamGoods()
 static void get_equip_param_goods_detour(get_equip_param_goods_result *result, int id) {
-    if ((id >= dummy_good_primary_color_start &&
-         id < dummy_good_primary_color_start + erdyes::colors.size()) ||
-        (id >= dummy_good_secondary_color_start &&
-         id < dummy_good_secondary_color_start + erdyes::colors.size()) ||
-        (id >= dummy_good_tertiary_color_start &&
-         id < dummy_good_tertiary_color_start + erdyes::colors.size()) ||
-        (id >= dummy_good_primary_intensity_start &&
-         id < dummy_good_primary_intensity_start + erdyes::intensities.size()) ||
-        (id >= dummy_good_secondary_intensity_start &&
-         id < dummy_good_secondary_intensity_start + erdyes::intensities.size()) ||
-        (id >= dummy_good_tertiary_intensity_start &&
-         id < dummy_good_tertiary_intensity_start + erdyes::intensities.size())) {
+    // This is called for every goods lookup in the game, so keep the path for vanilla items to a
+    // range check and, if telemetry is on, an unlocked increment
+    if (erdyes::config::telemetry) {
+        erdyes::telemetry::add_unlocked(goods_lookups);
+    }
+
+    if (erdyes::dummy_goods::contains(id, dummy_good_range_counts)) {
+        erdyes::trace::scope trace_scope{"GetEquipParamGoods (dummy goods)"};
+        if (erdyes::config::telemetry) {
+            erdyes::telemetry::add(erdyes::telemetry::counters->dummy_goods_lookups);
+        }
         result->id = id;
         result->row = &dummy_good;
         result->unk = 3;
@@ -124,31 +169,93 @@ void erdyes::local_player::init() {
         },
         get_equip_param_goods_detour, get_equip_param_goods);
 
-    // Add 10 hardcoded intensity options. The color options are added by erdyes_config.cpp based
-    // on the .ini file
-    erdyes::local_player::add_intensity_option(L"1", L"#1e1e1e", 0.125f);
-    erdyes::local_player::add_intensity_option(L"2", L"#3d3d3d", 0.25f);
-    erdyes::local_player::add_intensity_option(L"3", L"#4d4d4d", 0.5f);
-    erdyes::local_player::add_intensity_option(L"4", L"#656565", 1.0f);
-    erdyes::local_player::add_intensity_option(L"5", L"#7f7f7f", 2.0f);
-    erdyes::local_player::add_intensity_option(L"6", L"#9a9a9a", 4.0f);
-    erdyes::local_player::add_intensity_option(L"7", L"#b2b2b2", 8.0f);
-    erdyes::local_player::add_intensity_option(L"8", L"#c9c9c9", 16.0f);
-    erdyes::local_player::add_intensity_option(L"9", L"#e1e1e1", 32.0f);
-    erdyes::local_player::add_intensity_option(L"10", L"#ffffff", 64.0f);
+    // Add the intensity options from the .ini file. The color options are added by
+    // erdyes_config.cpp
+    auto count = erdyes::config::intensity_count;
+    auto min_intensity = erdyes::config::intensity_min;
+    auto max_intensity = erdyes::config::intensity_max;
+    intensities.reserve(count);
+    for (int i = 0; i < count; i++) {
+        auto t = count > 1 ? static_cast<float>(i) / (count - 1) : 0.0f;
+        auto intensity = erdyes::config::intensity_exponential
+                             ? min_intensity * pow(max_intensity / min_intensity, t)
+                             : min_intensity + (max_intensity - min_intensity) * t;
+
+        // Show a swatch from dark gray to white
+        auto gray = 0x1e + static_cast<int>(lround((0xff - 0x1e) * t));
+        erdyes::local_player::add_intensity_option(to_wstring(i + 1),
+                                                   format(L"#{0:02x}{0:02x}{0:02x}", gray),
+                                                   intensity);
+
+        // Default to whichever option is closest to the vanilla intensity of 1
+        if (abs(intensity - 1.0f) < abs(intensities[default_intensity_index].intensity - 1.0f)) {
+            default_intensity_index = i;
+        }
+    }
+
+    for (int i = 0; i < erdyes::dummy_goods::range_count; i++) {
+        auto [base_goods_id, count] = get_dye_target_goods_range(static_cast<dye_target_type>(i));
+        auto range = (base_goods_id - erdyes::dummy_goods::start) / erdyes::dummy_goods::range_size;
+        dummy_good_range_counts[range] =
+            static_cast<unsigned int>(min<size_t>(count, erdyes::dummy_goods::range_size));
+    }
 }
 
-void erdyes::local_player::update() {
+static bool find_recent_selections(array<int, 6> &indices);
+static void remember_selections(const array<int, 6> &indices);
+
+/**
+ * @returns the selected index of every dye target, checking the inventory. Each target checks its
+ * hint first, so a target whose selection matches the hint takes one lookup.
+ */
+static array<int, 6> probe_selected_indices(const array<int, 6> &hints) {
+    auto indices = array<int, 6>{};
+
+    auto probe_target = [&](erdyes::dye_target_type color_target,
+                            erdyes::dye_target_type intensity_target) {
+        auto color = static_cast<int>(color_target);
+        auto intensity = static_cast<int>(intensity_target);
+
+        indices[color] = erdyes::local_player::get_selected_index(color_target, hints[color]);
+
+        // The intensity doesn't matter if there's no color
+        indices[intensity] = indices[color] == -1
+                                 ? default_intensity_index
+                                 : erdyes::local_player::get_selected_index(intensity_target,
+                                                                            hints[intensity]);
+    };
+
+    probe_target(erdyes::dye_target_type::primary_color,
+                 erdyes::dye_target_type::primary_intensity);
+    probe_target(erdyes::dye_target_type::secondary_color,
+                 erdyes::dye_target_type::secondary_intensity);
+    probe_target(erdyes::dye_target_type::tertiary_color,
+                 erdyes::dye_target_type::tertiary_intensity);
+
+    return indices;
+}
+
+/**
+ * Update the local player's dyes to match the given selected indices
+ */
+static void set_selected_indices(const array<int, 6> &indices) {
+    if (indices == selected_indices) {
+        return;
+    }
+    selected_indices = indices;
+
     auto update_dye_value = [](erdyes::state::dye_value &dye_value,
                                erdyes::dye_target_type color_target,
                                erdyes::dye_target_type intensity_target) {
-        auto color_index = get_selected_index(color_target);
+        auto color_index = selected_indices[static_cast<int>(color_target)];
         if (is_valid_color_index(color_index)) {
-            auto intensity_index = get_selected_index(intensity_target);
+            auto intensity_index = selected_indices[static_cast<int>(intensity_target)];
             dye_value.is_applied = true;
             dye_value.red = erdyes::colors[color_index].red;
             dye_value.green = erdyes::colors[color_index].green;
             dye_value.blue = erdyes::colors[color_index].blue;
+            dye_value.animation_id = erdyes::colors[color_index].animation_id;
+            dye_value.animation_index = erdyes::colors[color_index].animation_index;
             dye_value.intensity = erdyes::intensities[intensity_index].intensity;
         } else {
             dye_value.is_applied = false;
@@ -161,6 +268,70 @@ void erdyes::local_player::update() {
                      erdyes::dye_target_type::secondary_intensity);
     update_dye_value(local_player_dyes.tertiary, erdyes::dye_target_type::tertiary_color,
                      erdyes::dye_target_type::tertiary_intensity);
+
+    erdyes::state::generations.local_dyes++;
+}
+
+void erdyes::local_player::update() {
+    struct update_inputs {
+        er::CS::PlayerIns *main_player;
+        dye_target_type talkscript_dye_target;
+        int talkscript_focused_entry;
+        unsigned int palette_generation;
+        unsigned int inventory_changes;
+
+        bool operator==(const update_inputs &) const = default;
+    };
+
+    static update_inputs last_inputs{};
+    static int frames_until_refresh = 0;
+    static int refreshes_until_absent_recheck = 0;
+
+    if (erdyes::config::telemetry) {
+        erdyes::telemetry::set(erdyes::telemetry::counters->goods_lookups,
+                               goods_lookups.load(memory_order_relaxed));
+    }
+
+    // Skip probing the inventory if nothing that could change the selections has changed
+    auto world_chr_man = er::CS::WorldChrManImp::instance();
+    auto inputs = update_inputs{
+        .main_player = world_chr_man ? world_chr_man->main_player : nullptr,
+        .talkscript_dye_target = erdyes::get_talkscript_dye_target(),
+        .talkscript_focused_entry = erdyes::get_talkscript_focused_entry(),
+        .palette_generation = erdyes::state::generations.palette,
+        .inventory_changes = inventory_changes,
+    };
+    if (erdyes::capture::enabled) {
+        erdyes::capture::record_focused_entry(inputs.talkscript_focused_entry);
+    }
+    if (inputs == last_inputs && --frames_until_refresh > 0) {
+        return;
+    }
+    auto is_new_character = inputs.main_player != last_inputs.main_player;
+    if (is_new_character || inputs.palette_generation != last_inputs.palette_generation ||
+        --refreshes_until_absent_recheck <= 0) {
+        known_absent.fill(false);
+        refreshes_until_absent_recheck = absent_recheck_refreshes;
+    }
+    last_inputs = inputs;
+    frames_until_refresh = refresh_interval_frames;
+
+    // Check the previous selections first, since they usually haven't changed. When a character is
+    // loaded, use a set of selections seen recently instead, such as from another save slot. These
+    // are only hints, and every target is still checked, so a recent set that only partly matches
+    // the new character can't be applied or sent to other players.
+    auto hints = selected_indices;
+    if (is_new_character) {
+        find_recent_selections(hints);
+    }
+    auto indices = probe_selected_indices(hints);
+
+    // Don't remember selections that are only being previewed in the menu
+    if (inputs.talkscript_dye_target == dye_target_type::none) {
+        remember_selections(indices);
+    }
+
+    set_selected_indices(indices);
 }
 
 /**
@@ -193,12 +364,104 @@ static pair<int, size_t> get_dye_target_goods_range(erdyes::dye_target_type dye_
     return {-1, 0};
 };
 
-void erdyes::local_player::add_color_option(
-    const wstring &name, const wstring &hex_code, float r, float g, float b) {
-    auto color_block = format_color_block(hex_code);
+/**
+ * @returns true if the main player has the dummy good for the given selection
+ */
+static bool has_selection_good(erdyes::dye_target_type dye_target, int index) {
+    auto world_chr_man = er::CS::WorldChrManImp::instance();
+    if (!world_chr_man || !world_chr_man->main_player) {
+        return false;
+    }
+
+    auto equip_inventory_data =
+        &world_chr_man->main_player->game_data->equip_game_data.equip_inventory_data;
+
+    auto [base_goods_id, count] = get_dye_target_goods_range(dye_target);
+    if (base_goods_id == -1 || index < 0 || index >= count) {
+        return false;
+    }
+
+    int item_id = item_type_goods + base_goods_id + index;
+    return get_inventory_id(equip_inventory_data, &item_id) != -1;
+}
+
+/**
+ * Look for the recently seen set of selections with the most dummy goods in the main player's
+ * inventory, to use as hints for probe_selected_indices(). This takes one inventory lookup per
+ * dye target that isn't the default.
+ */
+static bool find_recent_selections(array<int, 6> &indices) {
+    int best_match_count = 0;
+    for (size_t i = 0; i < recent_selections_count; i++) {
+        auto &selections = recent_selections[i];
+
+        int match_count = 0;
+        for (int target = 0; target < selections.size(); target++) {
+            auto dye_target = static_cast<erdyes::dye_target_type>(target);
+            auto default_index = is_color(dye_target) ? default_color_index
+                                                      : default_intensity_index;
+            if (selections[target] == default_index) {
+                continue;
+            }
+            if (!has_selection_good(dye_target, selections[target])) {
+                match_count = 0;
+                break;
+            }
+            match_count++;
+        }
+
+        if (match_count > best_match_count) {
+            best_match_count = match_count;
+            indices = selections;
+        }
+    }
+
+    return best_match_count > 0;
+}
+
+/**
+ * Move the given selections to the front of the recently seen list
+ */
+static void remember_selections(const array<int, 6> &indices) {
+    auto end = recent_selections.begin() + recent_selections_count;
+    auto existing = find(recent_selections.begin(), end, indices);
+    if (existing == end) {
+        if (recent_selections_count < recent_selections.size()) {
+            recent_selections_count++;
+        }
+        existing = recent_selections.begin() + recent_selections_count - 1;
+    }
+
+    rotate(recent_selections.begin(), existing, existing + 1);
+    recent_selections[0] = indices;
+}
+
+void erdyes::local_player::add_color_option(const wstring &name,
+                                            const wstring &hex_code,
+                                            float r,
+                                            float g,
+                                            float b,
+                                            unsigned int animation_id,
+                                            int animation_index) {
+    auto &color_block = color_strings.emplace_back(format_color_block(hex_code));
     auto label = color_block + name;
-    colors.emplace_back(color_block, erdyes::format_option_message(label, true),
-                        erdyes::format_option_message(label, false), r, g, b);
+    auto &selected_message =
+        color_strings.emplace_back(erdyes::format_option_message(label, true));
+    auto &deselected_message =
+        color_strings.emplace_back(erdyes::format_option_message(label, false));
+    colors.emplace_back(color_block, selected_message, deselected_message, r, g, b, animation_id,
+                        animation_index);
+    erdyes::state::generations.palette++;
+}
+
+void erdyes::local_player::add_prerendered_color_option(wstring_view color_block,
+                                                        wstring_view selected_message,
+                                                        wstring_view deselected_message,
+                                                        float r,
+                                                        float g,
+                                                        float b) {
+    colors.emplace_back(color_block, selected_message, deselected_message, r, g, b, 0, -1);
+    erdyes::state::generations.palette++;
 }
 
 void erdyes::local_player::add_intensity_option(const wstring &name,
@@ -208,22 +471,46 @@ void erdyes::local_player::add_intensity_option(const wstring &name,
     auto label = color_block + name;
     intensities.emplace_back(color_block, erdyes::format_option_message(label, true),
                              erdyes::format_option_message(label, false), i);
+    erdyes::state::generations.palette++;
 }
 
 const erdyes::state::dye_values &erdyes::local_player::get_selected_dyes() {
     return local_player_dyes;
 }
 
+const array<int, 6> &erdyes::local_player::get_selected_indices() { return selected_indices; }
+
 void erdyes::local_player::update_dye_target_messages() {
-    auto set_messages = [](dye_target_type color_target, dye_target_type intensity_target,
-                           const wstring &color_msg, const wstring &intensity_msg) {
+    static unsigned int message_local_dyes_generation = 0;
+    static unsigned int message_palette_generation = 0;
+    static unsigned int message_messages_generation = 0;
+
+    // Pick up any selection that was just made in the menu. This only checks the inventory if
+    // something changed since the last update.
+    update();
+
+    // Skip rebuilding the messages if the selections are the same as last time
+    if (message_local_dyes_generation == erdyes::state::generations.local_dyes &&
+        message_palette_generation == erdyes::state::generations.palette &&
+        message_messages_generation == erdyes::state::generations.messages &&
+        !dye_target_messages[0].empty()) {
+        return;
+    }
+    message_local_dyes_generation = erdyes::state::generations.local_dyes;
+    message_palette_generation = erdyes::state::generations.palette;
+    message_messages_generation = erdyes::state::generations.messages;
+
+    auto &indices = selected_indices;
+
+    auto set_messages = [&](dye_target_type color_target, dye_target_type intensity_target,
+                            const wstring &color_msg, const wstring &intensity_msg) {
         auto &color_message = dye_target_messages[static_cast<int>(color_target)];
         auto &intensity_message = dye_target_messages[static_cast<int>(intensity_target)];
 
-        auto color_index = get_selected_index(color_target);
-        auto intensity_index = get_selected_index(intensity_target);
+        auto color_index = indices[static_cast<int>(color_target)];
+        auto intensity_index = indices[static_cast<int>(intensity_target)];
         if (color_index != -1) {
-            color_message = colors[color_index].color_block + color_msg;
+            color_message = wstring{colors[color_index].color_block} + color_msg;
             intensity_message = intensities[intensity_index].color_block + intensity_msg;
         } else {
             color_message =
@@ -247,7 +534,7 @@ void erdyes::local_player::update_dye_target_messages() {
                  messages.tertiary_color, messages.tertiary_intensity);
 }
 
-int erdyes::local_player::get_selected_index(erdyes::dye_target_type dye_target) {
+int erdyes::local_player::get_selected_index(erdyes::dye_target_type dye_target, int hint) {
     auto is_dye_target_color = is_color(dye_target);
 
     // Return the focused talkscript menu option if the dye target is currently being edited
@@ -274,6 +561,19 @@ int erdyes::local_player::get_selected_index(erdyes::dye_target_type dye_target)
         return -1;
     }
 
+    auto default_index = is_dye_target_color ? default_color_index : default_intensity_index;
+    auto &is_known_absent = known_absent[static_cast<int>(dye_target)];
+    if (is_known_absent) {
+        return default_index;
+    }
+
+    if (hint >= 0 && hint < count) {
+        int item_id = item_type_goods + base_goods_id + hint;
+        if (get_inventory_id(equip_inventory_data, &item_id) != -1) {
+            return hint;
+        }
+    }
+
     for (int i = 0; i < count; i++) {
         int goods_id = base_goods_id + i;
         int item_id = item_type_goods + goods_id;
@@ -281,7 +581,9 @@ int erdyes::local_player::get_selected_index(erdyes::dye_target_type dye_target)
             return i;
         }
     }
-    return is_dye_target_color ? default_color_index : default_intensity_index;
+
+    is_known_absent = true;
+    return default_index;
 }
 
 void erdyes::local_player::set_selected_index(erdyes::dye_target_type dye_target, int index) {
@@ -290,6 +592,9 @@ void erdyes::local_player::set_selected_index(erdyes::dye_target_type dye_target
         return;
     }
 
+    inventory_changes++;
+    known_absent[static_cast<int>(dye_target)] = false;
+
     auto world_chr_man = er::CS::WorldChrManImp::instance();
     if (!world_chr_man || !world_chr_man->main_player) {
         return;
@@ -1,41 +1,17 @@
 #pragma once
 
 #include "erdyes_dye_values.hpp"
+#include "erdyes_palette.hpp"
 
 #include <elden-x/chr/chr.hpp>
 
 #include <array>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace erdyes {
 
-struct color {
-    std::wstring color_block;
-    std::wstring selected_message;
-    std::wstring deselected_message;
-    float red;
-    float green;
-    float blue;
-};
-
-struct intensity {
-    std::wstring color_block;
-    std::wstring selected_message;
-    std::wstring deselected_message;
-    float intensity;
-};
-
-enum class dye_target_type : int {
-    none = -1,
-    primary_color,
-    secondary_color,
-    tertiary_color,
-    primary_intensity,
-    secondary_intensity,
-    tertiary_intensity,
-};
-
 extern std::array<std::wstring, 6> dye_target_messages;
 
 // Available colors/intensities that can be selected by the local player
@@ -52,10 +28,29 @@ void init();
 void update();
 
 /**
- * Add an option that can be chosen as the primary, secondary, or tertiary dye color
+ * Add an option that can be chosen as the primary, secondary, or tertiary dye color. Animated
+ * colors also pass the ID and index from erdyes::animated_dyes, and r/g/b are shown to players
+ * that don't have the same animation.
+ */
+void add_color_option(const std::wstring &name,
+                      const std::wstring &hex_code,
+                      float r,
+                      float g,
+                      float b,
+                      unsigned int animation_id = 0,
+                      int animation_index = -1);
+
+/**
+ * Add a color option with menu messages that were already formatted, for example from a cache.
+ * The messages aren't copied, so they must be null-terminated and stay valid for the rest of the
+ * process.
  */
-void add_color_option(
-    const std::wstring &name, const std::wstring &hex_code, float r, float g, float b);
+void add_prerendered_color_option(std::wstring_view color_block,
+                                  std::wstring_view selected_message,
+                                  std::wstring_view deselected_message,
+                                  float r,
+                                  float g,
+                                  float b);
 
 /**
  * Add an option that can be chosen as the intensity of the primary, secondary, or tertiary color
@@ -67,6 +62,12 @@ void add_intensity_option(const std::wstring &name, const std::wstring &hex_code
  */
 const erdyes::state::dye_values &get_selected_dyes();
 
+/**
+ * @returns the selected index of each dye target for the local main player, as of the last
+ * update()
+ */
+const std::array<int, 6> &get_selected_indices();
+
 /**
  * Update "Primary color", "Secondary color", etc. messages to show the selected color for each
  * category
@@ -75,9 +76,10 @@ void update_dye_target_messages();
 
 /**
  * @returns the selected index of the given color or intensity option to the given index, or -1 for
- * none, for the local main player
+ * none, for the local main player. If a hint is given, that index is checked first. A target with
+ * nothing selected isn't searched again until it's set, or update() decides to check again.
  */
-int get_selected_index(erdyes::dye_target_type);
+int get_selected_index(erdyes::dye_target_type, int hint = -1);
 
 /**
  * Set one of the color or intensity option to the given index, or -1 for none
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "erdyes_messages.hpp"
+#include "erdyes_palette.hpp"
+
+#include <array>
+#include <string>
+#include <vector>
+
+namespace erdyes {
+
+/**
+ * The strings returned for message IDs added by the mod. These point to the containers that own
+ * the strings, so the table stays valid when the strings are rebuilt.
+ */
+struct message_table {
+    const std::wstring *apply_dyes;
+    const std::array<std::wstring, 6> *dye_target_messages;
+    const std::wstring *none_deselected;
+    const std::wstring *none_selected;
+    const std::wstring *back;
+    const std::vector<color> *colors;
+    const std::vector<intensity> *intensities;
+};
+
+/**
+ * @returns true if the given EventTextForTalk message ID is in the range used by the mod
+ */
+inline bool is_mod_message(int msg_id) {
+    return msg_id >= event_text_for_talk::mod_message_start &&
+           msg_id < event_text_for_talk::mod_message_end;
+}
+
+/**
+ * @returns the menu text for a message ID added by the mod, or nullptr if there isn't one
+ */
+inline const wchar_t *lookup_mod_message(const message_table &table, int msg_id) {
+    auto &colors = *table.colors;
+    auto &intensities = *table.intensities;
+    auto color_count = static_cast<int>(colors.size());
+    auto intensity_count = static_cast<int>(intensities.size());
+
+    if (msg_id == event_text_for_talk::apply_dyes) {
+        return table.apply_dyes->data();
+    } else if (msg_id >= event_text_for_talk::primary_color &&
+               msg_id <= event_text_for_talk::tertiary_intensity) {
+        // The six dye target messages are consecutive, in the same order as dye_target_type
+        auto i = msg_id - event_text_for_talk::primary_color;
+        return (*table.dye_target_messages)[i].data();
+    } else if (msg_id == event_text_for_talk::none_deselected) {
+        return table.none_deselected->data();
+    } else if (msg_id == event_text_for_talk::none_selected) {
+        return table.none_selected->data();
+    } else if (msg_id == event_text_for_talk::back) {
+        return table.back->data();
+    } else if (msg_id >= event_text_for_talk::dye_color_selected_start &&
+               msg_id < event_text_for_talk::dye_color_selected_start + color_count) {
+        auto color_index = msg_id - event_text_for_talk::dye_color_selected_start;
+        return colors[color_index].selected_message.data();
+    } else if (msg_id >= event_text_for_talk::dye_color_deselected_start &&
+               msg_id < event_text_for_talk::dye_color_deselected_start + color_count) {
+        auto color_index = msg_id - event_text_for_talk::dye_color_deselected_start;
+        return colors[color_index].deselected_message.data();
+    } else if (msg_id >= event_text_for_talk::dye_intensity_selected_start &&
+               msg_id < event_text_for_talk::dye_intensity_selected_start + intensity_count) {
+        auto intensity_index = msg_id - event_text_for_talk::dye_intensity_selected_start;
+        return intensities[intensity_index].selected_message.data();
+    } else if (msg_id >= event_text_for_talk::dye_intensity_deselected_start &&
+               msg_id < event_text_for_talk::dye_intensity_deselected_start + intensity_count) {
+        auto intensity_index = msg_id - event_text_for_talk::dye_intensity_deselected_start;
+        return intensities[intensity_index].deselected_message.data();
+    }
+
+    return nullptr;
+}
+
+}
@@ -5,10 +5,14 @@
  * function to return them.
  */
 #include "erdyes_messages.hpp"
+#include "erdyes_config.hpp"
 #include "erdyes_local_player.hpp"
+#include "erdyes_message_table.hpp"
+#include "erdyes_state.hpp"
+#include "erdyes_telemetry.hpp"
+#include "erdyes_trace.hpp"
 
 #include <chrono>
-#include <map>
 #include <thread>
 
 #include <spdlog/spdlog.h>
@@ -25,6 +29,16 @@ static wstring none_deselected_msg;
 static wstring none_selected_msg;
 static wstring back_msg;
 
+static const erdyes::message_table message_table = {
+    .apply_dyes = &apply_dyes_msg,
+    .dye_target_messages = &erdyes::dye_target_messages,
+    .none_deselected = &none_deselected_msg,
+    .none_selected = &none_selected_msg,
+    .back = &back_msg,
+    .colors = &erdyes::colors,
+    .intensities = &erdyes::intensities,
+};
+
 static const wchar_t *(*msg_repository_lookup_entry)(er::CS::MsgRepositoryImp *,
                                                      unsigned int,
                                                      er::msgbnd,
@@ -40,57 +54,15 @@ static const wchar_t *msg_repository_lookup_entry_detour(er::CS::MsgRepositoryIm
                                                          unsigned int unknown,
                                                          er::msgbnd bnd_id,
                                                          int msg_id) {
-    if (bnd_id == er::msgbnd::event_text_for_talk &&
-        msg_id >= erdyes::event_text_for_talk::mod_message_start &&
-        msg_id < erdyes::event_text_for_talk::mod_message_end) {
-        if (msg_id == erdyes::event_text_for_talk::apply_dyes) {
-            return apply_dyes_msg.data();
-        } else if (msg_id == erdyes::event_text_for_talk::primary_color) {
-            auto i = static_cast<int>(erdyes::dye_target_type::primary_color);
-            return erdyes::dye_target_messages[i].data();
-        } else if (msg_id == erdyes::event_text_for_talk::secondary_color) {
-            auto i = static_cast<int>(erdyes::dye_target_type::secondary_color);
-            return erdyes::dye_target_messages[i].data();
-        } else if (msg_id == erdyes::event_text_for_talk::tertiary_color) {
-            auto i = static_cast<int>(erdyes::dye_target_type::tertiary_color);
-            return erdyes::dye_target_messages[i].data();
-        } else if (msg_id == erdyes::event_text_for_talk::primary_intensity) {
-            auto i = static_cast<int>(erdyes::dye_target_type::primary_intensity);
-            return erdyes::dye_target_messages[i].data();
-        } else if (msg_id == erdyes::event_text_for_talk::secondary_intensity) {
-            auto i = static_cast<int>(erdyes::dye_target_type::secondary_intensity);
-            return erdyes::dye_target_messages[i].data();
-        } else if (msg_id == erdyes::event_text_for_talk::tertiary_intensity) {
-            auto i = static_cast<int>(erdyes::dye_target_type::tertiary_intensity);
-            return erdyes::dye_target_messages[i].data();
-        } else if (msg_id == erdyes::event_text_for_talk::none_deselected) {
-            return none_deselected_msg.data();
-        } else if (msg_id == erdyes::event_text_for_talk::none_selected) {
-            return none_selected_msg.data();
-        } else if (msg_id == erdyes::event_text_for_talk::back) {
-            return back_msg.data();
-        } else if (msg_id >= erdyes::event_text_for_talk::dye_color_selected_start &&
-                   msg_id < erdyes::event_text_for_talk::dye_color_selected_start +
-                                erdyes::colors.size()) {
-            auto color_index = msg_id - erdyes::event_text_for_talk::dye_color_selected_start;
-            return erdyes::colors[color_index].selected_message.data();
-        } else if (msg_id >= erdyes::event_text_for_talk::dye_color_deselected_start &&
-                   msg_id < erdyes::event_text_for_talk::dye_color_deselected_start +
-                                erdyes::colors.size()) {
-            auto color_index = msg_id - erdyes::event_text_for_talk::dye_color_deselected_start;
-            return erdyes::colors[color_index].deselected_message.data();
-        } else if (msg_id >= erdyes::event_text_for_talk::dye_intensity_selected_start &&
-                   msg_id < erdyes::event_text_for_talk::dye_intensity_selected_start +
-                                erdyes::intensities.size()) {
-            auto intensity_index =
-                msg_id - erdyes::event_text_for_talk::dye_intensity_selected_start;
-            return erdyes::intensities[intensity_index].selected_message.data();
-        } else if (msg_id >= erdyes::event_text_for_talk::dye_intensity_deselected_start &&
-                   msg_id < erdyes::event_text_for_talk::dye_intensity_deselected_start +
-                                erdyes::intensities.size()) {
-            auto intensity_index =
-                msg_id - erdyes::event_text_for_talk::dye_intensity_deselected_start;
-            return erdyes::intensities[intensity_index].deselected_message.data();
+    if (bnd_id == er::msgbnd::event_text_for_talk && erdyes::is_mod_message(msg_id)) {
+        erdyes::trace::scope trace_scope{"MsgRepositoryImp::LookupEntry"};
+        if (erdyes::config::telemetry) {
+            erdyes::telemetry::add(erdyes::telemetry::counters->message_lookups);
+        }
+
+        auto message = erdyes::lookup_mod_message(message_table, msg_id);
+        if (message) {
+            return message;
         }
     }
 
@@ -116,40 +88,64 @@ void erdyes::setup_messages() {
         },
         msg_repository_lookup_entry_detour, msg_repository_lookup_entry);
 
-    // Pick the messages to use based on the player's selected language for the game in Steam
-    auto language = string{SteamApps()->GetCurrentGameLanguage()};
+    refresh_messages();
+}
+
+// Inputs that the messages were last built from
+static string current_language;
+static bool is_rtl = false;
+static bool is_reforged = false;
 
-    auto localized_messages = messages_by_lang.find(language);
-    if (localized_messages != messages_by_lang.end()) {
-        spdlog::info("Detected language \"{}\"", language);
-        messages = localized_messages->second;
+/**
+ * Rebuild the messages that depend on the language
+ */
+static void rebuild_language_messages() {
+    auto localized_messages = erdyes::find_messages_by_lang(current_language);
+    if (localized_messages) {
+        spdlog::info("Detected language \"{}\"", current_language);
     } else {
-        spdlog::warn("Unknown language \"{}\", defaulting to English", language);
-        messages = messages_by_lang.at("english");
+        spdlog::warn("Unknown language \"{}\", defaulting to English", current_language);
+        localized_messages = erdyes::find_messages_by_lang("english");
     }
 
-    apply_dyes_msg = messages.apply_dyes;
+    erdyes::messages = {
+        .apply_dyes = wstring{localized_messages->apply_dyes},
+        .primary_color = wstring{localized_messages->primary_color},
+        .secondary_color = wstring{localized_messages->secondary_color},
+        .tertiary_color = wstring{localized_messages->tertiary_color},
+        .primary_intensity = wstring{localized_messages->primary_intensity},
+        .secondary_intensity = wstring{localized_messages->secondary_intensity},
+        .tertiary_intensity = wstring{localized_messages->tertiary_intensity},
+        .none = wstring{localized_messages->none},
+        .back = wstring{localized_messages->back},
+    };
 
     // Detect if a right-to-left language is being used, since Elden Ring's poor text shaping
     // support requires us to change the order of some messages
-    bool is_rtl = language == "arabic";
+    is_rtl = current_language == "arabic";
 
-    // Detect if the ELDEN RING: Reforged mod is running, since some adjustments to menu text
-    // are needed
-    auto calibrations_ver = wstring_view{msg_repository_lookup_entry(
-        er::CS::MsgRepositoryImp::instance(), 0, er::msgbnd::menu_text, 401322)};
-    bool is_reforged = calibrations_ver.find(L"ELDEN RING Reforged") != wstring::npos;
-
-    none_deselected_msg = format_option_message(L" " + messages.none, false, is_rtl);
-    none_selected_msg = format_option_message(L" " + messages.none, true, is_rtl);
+    auto none_label = L" " + erdyes::messages.none;
+    none_deselected_msg = erdyes::format_option_message(none_label, false, is_rtl);
+    none_selected_msg = erdyes::format_option_message(none_label, true, is_rtl);
 
     const wstring back_spacer =
         L"<IMG SRC='img://MENU_DummyTransparent.dds' WIDTH='32' "
         L"HEIGHT='2' HSPACE='0' VSPACE='-1'>";
     if (is_rtl)
-        back_msg = messages.back + L" " + back_spacer;
+        back_msg = erdyes::messages.back + L" " + back_spacer;
     else
-        back_msg = back_spacer + L" " + messages.back;
+        back_msg = back_spacer + L" " + erdyes::messages.back;
+
+    // The "Primary color", "Secondary color", etc. messages include the translated names
+    erdyes::state::generations.messages++;
+}
+
+/**
+ * Rebuild the "Apply dyes" message, which depends on both the language and whether Reforged is
+ * running
+ */
+static void rebuild_apply_dyes_message() {
+    apply_dyes_msg = erdyes::messages.apply_dyes;
 
     // Add an icon to the "Apply dyes" option to align with the other menu items in Reforged
     if (is_reforged) {
@@ -162,6 +158,37 @@ void erdyes::setup_messages() {
     }
 }
 
+void erdyes::refresh_messages() {
+    erdyes::trace::scope trace_scope{"refresh_messages"};
+
+    // Pick the messages to use based on the player's selected language for the game in Steam
+    auto language = SteamApps()->GetCurrentGameLanguage();
+    auto language_changed = current_language != language;
+
+    // Detect if the ELDEN RING: Reforged mod is running, since some adjustments to menu text
+    // are needed. This is checked again in case another mod patches the menu text later.
+    auto calibrations_ver = wstring_view{msg_repository_lookup_entry(
+        er::CS::MsgRepositoryImp::instance(), 0, er::msgbnd::menu_text, 401322)};
+    auto reforged = calibrations_ver.find(L"ELDEN RING Reforged") != wstring::npos;
+    auto reforged_changed = reforged != is_reforged;
+
+    if (!language_changed && !reforged_changed) {
+        return;
+    }
+
+    if (reforged_changed) {
+        spdlog::info("ELDEN RING Reforged {}", reforged ? "detected" : "no longer detected");
+        is_reforged = reforged;
+    }
+
+    if (language_changed) {
+        current_language = language;
+        rebuild_language_messages();
+    }
+
+    rebuild_apply_dyes_message();
+}
+
 wstring erdyes::format_option_message(wstring const &label, bool selected, bool rtl) {
     auto img_src = selected ? L"MENU_Lockon_01a.png" : L"MENU_DummyTransparent.dds";
     auto icon = wstring{L"<IMG SRC='img://"} + img_src +
@@ -1,12 +1,18 @@
 #pragma once
 
-#include <map>
 #include <string>
+#include <string_view>
 
 namespace erdyes {
 
 void setup_messages();
 
+/**
+ * Rebuild any messages whose inputs have changed since they were last built, such as the game
+ * language or the menu text of ELDEN RING Reforged
+ */
+void refresh_messages();
+
 struct messages_type {
     std::wstring apply_dyes;
     std::wstring primary_color;
@@ -19,8 +25,28 @@ struct messages_type {
     std::wstring back;
 };
 
+/**
+ * Translated messages for one language, stored as constant data
+ */
+struct message_views {
+    std::wstring_view apply_dyes;
+    std::wstring_view primary_color;
+    std::wstring_view secondary_color;
+    std::wstring_view tertiary_color;
+    std::wstring_view primary_intensity;
+    std::wstring_view secondary_intensity;
+    std::wstring_view tertiary_intensity;
+    std::wstring_view none;
+    std::wstring_view back;
+};
+
 extern messages_type messages;
-extern std::map<std::string, messages_type> messages_by_lang;
+
+/**
+ * @returns the translated messages for the given Steam language name, or nullptr if there is no
+ * translation
+ */
+const message_views *find_messages_by_lang(std::string_view language);
 
 /**
  * Format one of the color or intensity menu options
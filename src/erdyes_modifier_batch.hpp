@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string>
+
+namespace erdyes {
+
+// Maximum number of tint modifiers applied to one character
+static constexpr size_t max_tint_modifiers = 4;
+
+/**
+ * Write a batch of prepared tint modifiers to a character's modifier vector. Modifiers that are
+ * already in the vector are overwritten in a single pass over it, and the rest are appended after
+ * growing the vector at most once.
+ *
+ * This is a template over the modifier and vector types so it can be benchmarked without the game.
+ */
+template <typename modifier_type, typename vector_type>
+void write_modifiers(vector_type &modifiers,
+                     const std::array<modifier_type, max_tint_modifiers> &new_modifiers,
+                     const std::array<const std::wstring *, max_tint_modifiers> &new_modifier_names,
+                     size_t count) {
+    if (count == 0) {
+        return;
+    }
+
+    // Note that we write over the entire modifier and not just the RGB fields because the game
+    // zeros out this memory each frame.
+    std::array<bool, max_tint_modifiers> is_written{};
+    size_t written_count = 0;
+    for (auto &modifier : modifiers) {
+        for (size_t i = 0; i < count; i++) {
+            if (!is_written[i] && (modifier.name == new_modifier_names[i]->data() ||
+                                   modifier.name == *new_modifier_names[i])) {
+                modifier = new_modifiers[i];
+                is_written[i] = true;
+                written_count++;
+                break;
+            }
+        }
+
+        if (written_count == count) {
+            return;
+        }
+    }
+
+    modifiers.reserve(modifiers.size() + count - written_count);
+    for (size_t i = 0; i < count; i++) {
+        if (!is_written[i]) {
+            modifiers.push_back(new_modifiers[i]);
+        }
+    }
+}
+
+}
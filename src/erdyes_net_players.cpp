@@ -2,9 +2,19 @@
  * erdyes_net_players.cpp
  *
  * Sends and receives messages to other players in Seamless Co-op so dye state can be synced between
- * multiple players with this mod installed
+ * multiple players with this mod installed. Messages are received and decoded on a separate
+ * thread, which publishes snapshots of the results for the game thread to read.
  */
 #include "erdyes_net_players.hpp"
+#include "erdyes_capture.hpp"
+#include "erdyes_config.hpp"
+#include "erdyes_dye_encoding.hpp"
+#include "erdyes_local_player.hpp"
+#include "erdyes_palette_match.hpp"
+#include "erdyes_state.hpp"
+#include "erdyes_telemetry.hpp"
+#include "erdyes_trace.hpp"
+#include "erdyes_triple_buffer.hpp"
 
 #include <spdlog/spdlog.h>
 #include <steam/isteamnetworkingmessages.h>
@@ -13,20 +23,77 @@
 #include <elden-x/session.hpp>
 
 #include <algorithm>
-#include <map>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <span>
+#include <thread>
 
 using namespace std;
 
-static map<unsigned long long, erdyes::state::dye_values> net_colors_map;
+struct net_player_entry {
+    // Steam ID of the player who sent the dye state, or 0 if the slot is unused
+    unsigned long long steam_id{0};
+    // Hash of the player's palette, used to decide how to encode messages sent to them
+    unsigned int palette_hash{0};
+    erdyes::state::dye_values dyes;
+};
 
-static constexpr int steam_networking_channel_dyes = 100067;
+// Flat table of dye states received from other players. Entries stay in the same slot while the
+// player is connected, so characters can cache their slot between frames.
+typedef array<net_player_entry, erdyes::net_players::max_net_players> net_player_table;
+
+struct connected_players {
+    array<unsigned long long, erdyes::net_players::max_net_players> steam_ids;
+    size_t count;
+};
+
+// Table owned by the network thread, which is copied into a snapshot whenever it changes
+static net_player_table working_entries;
+
+// Snapshots of working_entries published by the network thread for the game thread
+static erdyes::triple_buffer<net_player_table> net_player_snapshots;
+
+// Players in the current session, published by the game thread for the network thread
+static erdyes::triple_buffer<connected_players> connected_player_snapshots;
+
+// How often the network thread checks for new messages
+static constexpr auto receive_interval = chrono::milliseconds{5};
+
+// How often the network thread checks for new messages when there's nobody else in the session
+static constexpr auto idle_receive_interval = chrono::milliseconds{100};
+
+static thread network_thread;
+static atomic<bool> stop_network_thread{false};
+
+static const erdyes::state::dye_values empty_dyes{};
+
+// Hash of the local palette, which doesn't change after the network thread starts
+static unsigned int palette_hash = 0;
+
+// Messages are sent on a new channel whenever their format changes, so versions of the mod with
+// incompatible formats never receive each other's messages
+static constexpr int steam_networking_channel_dyes = 100068;
+
+// Channel used by older versions, which sent the raw dye_values struct
+static constexpr int steam_networking_channel_dyes_legacy = 100067;
+
+void erdyes::net_players::send_messages(const erdyes::state::dye_values &local_player_dyes,
+                                        const array<int, 6> &local_player_indices) {
+    erdyes::trace::scope trace_scope{"net_players::send_messages"};
 
-void erdyes::net_players::send_messages(const erdyes::state::dye_values &local_player_dyes) {
     auto session_manager = er::CS::CSSessionManagerImp::instance();
 
     auto local_player_steam_id = SteamUser()->GetSteamID().ConvertToUint64();
 
+    // Players with the same palette are sent indices, and everyone else is sent colors
+    dye_encoding::message_buffer indices_message;
+    auto indices_message_size =
+        dye_encoding::encode_indices(local_player_indices, palette_hash, indices_message);
+    dye_encoding::message_buffer values_message;
+    auto values_message_size =
+        dye_encoding::encode_values(local_player_dyes, palette_hash, values_message);
+
     // Send the local player's dye selections to every connected player in the current session
     for (auto &entry : session_manager->player_entries()) {
         // Don't send messages to ourself
@@ -37,55 +104,272 @@ void erdyes::net_players::send_messages(const erdyes::state::dye_values &local_p
         SteamNetworkingIdentity id;
         id.SetSteamID(entry.steam_id);
 
+        auto slot = find_slot(entry.steam_id);
+        auto has_same_palette =
+            slot != -1 && net_player_snapshots.front()[slot].palette_hash == palette_hash;
+
+        auto message_size = has_same_palette ? indices_message_size : values_message_size;
         auto result = SteamNetworkingMessages()->SendMessageToUser(
-            id, &local_player_dyes, sizeof(local_player_dyes), k_nSteamNetworkingSend_Reliable,
-            steam_networking_channel_dyes);
-        if (result != k_EResultOK) {
+            id, has_same_palette ? indices_message.data() : values_message.data(), message_size,
+            k_nSteamNetworkingSend_Reliable, steam_networking_channel_dyes);
+        if (result == k_EResultOK) {
+            if (erdyes::config::telemetry) {
+                erdyes::telemetry::add(erdyes::telemetry::counters->messages_sent);
+                erdyes::telemetry::add(erdyes::telemetry::counters->bytes_sent, message_size);
+            }
+        } else {
+            if (erdyes::config::telemetry) {
+                erdyes::telemetry::add(erdyes::telemetry::counters->send_errors);
+            }
             spdlog::error("Error {} sending Steam networking message to user {}", (int)result,
                           id.GetSteamID64());
         }
     }
 }
 
-void erdyes::net_players::receive_messages() {
+/**
+ * Replace received static colors with the closest colors in the local palette
+ */
+static void match_palette(erdyes::state::dye_values &dyes) {
+    for (auto value : {&dyes.primary, &dyes.secondary, &dyes.tertiary}) {
+        if (!value->is_applied || value->animation_index != -1) {
+            continue;
+        }
+
+        auto quantize = [](float channel) {
+            return static_cast<unsigned char>(clamp(channel, 0.0f, 1.0f) * 255.0f + 0.5f);
+        };
+        auto color_index = erdyes::palette_match::find_nearest(
+            quantize(value->red), quantize(value->green), quantize(value->blue));
+        if (color_index != -1) {
+            auto &color = erdyes::colors[color_index];
+            value->red = color.red;
+            value->green = color.green;
+            value->blue = color.blue;
+        }
+    }
+}
+
+/**
+ * Check for new messages from the Steamworks API containing the dye state of other connected
+ * players. This runs on the network thread.
+ *
+ * @returns true if working_entries was changed
+ */
+static bool receive_messages() {
     static SteamNetworkingMessage_t *buffer[100];
 
-    // Check for new messages from the Steamworks API containing the dye state of other connected
-    // players
+    auto start_time =
+        erdyes::trace::enabled ? chrono::steady_clock::now() : chrono::steady_clock::time_point{};
+
     auto count = SteamNetworkingMessages()->ReceiveMessagesOnChannel(
         steam_networking_channel_dyes, buffer, sizeof(buffer) / sizeof(buffer[0]));
-    auto messages = span{buffer, static_cast<size_t>(count)};
+    auto messages = span{buffer, static_cast<size_t>(max(count, 0))};
 
+    bool changed = false;
+    auto counters = erdyes::telemetry::counters;
     for (auto &message : messages) {
         auto steam_id = message->m_identityPeer.GetSteamID64();
-        auto &net_colors = *reinterpret_cast<const erdyes::state::dye_values *>(message->GetData());
+        auto data = span{static_cast<const unsigned char *>(message->GetData()),
+                         static_cast<size_t>(message->GetSize())};
+
+        if (erdyes::capture::enabled) {
+            erdyes::capture::record_message(steam_id, data);
+        }
+
+        if (erdyes::config::telemetry) {
+            erdyes::telemetry::add(counters->messages_received);
+            erdyes::telemetry::add(counters->bytes_received, message->GetSize());
+        }
+
+        // Ignore messages from incompatible versions of the mod, and players we don't have room for
+        auto entry = find_if(working_entries.begin(), working_entries.end(),
+                             [&](auto &other) { return other.steam_id == steam_id; });
+        if (entry == working_entries.end()) {
+            entry = find_if(working_entries.begin(), working_entries.end(),
+                            [](auto &other) { return other.steam_id == 0; });
+        }
+        if (steam_id == 0 || entry == working_entries.end()) {
+            if (erdyes::config::telemetry) {
+                erdyes::telemetry::add(counters->messages_rejected);
+            }
+            message->Release();
+            continue;
+        }
 
-        if (!net_colors_map.contains(steam_id)) {
-            spdlog::debug("Received dye values from user {}", steam_id);
+        erdyes::state::dye_values dyes;
+        unsigned int sender_palette_hash;
+        if (erdyes::dye_encoding::decode(data, palette_hash, erdyes::colors, erdyes::intensities,
+                                         dyes, sender_palette_hash)) {
+            if (erdyes::config::match_palette) {
+                match_palette(dyes);
+            }
+
+            entry->steam_id = steam_id;
+            entry->palette_hash = sender_palette_hash;
+            entry->dyes = dyes;
+            changed = true;
+        } else if (erdyes::config::telemetry) {
+            erdyes::telemetry::add(counters->messages_rejected);
         }
 
-        net_colors_map[steam_id] = net_colors;
         message->Release();
     }
 
-    // Remove entries for players who aren't connected anymore
-    auto player_entries = er::CS::CSSessionManagerImp::instance()->player_entries();
-    for (auto it = net_colors_map.begin(); it != net_colors_map.end();) {
-        if (none_of(player_entries.begin(), player_entries.end(),
-                    [&](auto entry) { return entry.steam_id == it->first; })) {
-            spdlog::debug("Disconnected from user {}", it->first);
-            it = net_colors_map.erase(it);
-        } else {
-            it++;
+    // Most polls don't receive anything, so only trace the ones that do
+    if (erdyes::trace::enabled && !messages.empty()) {
+        erdyes::trace::record("net_players::receive_messages", start_time,
+                              chrono::steady_clock::now());
+    }
+
+    return changed;
+}
+
+/**
+ * Throw away messages sent by older versions of the mod, so Steam doesn't keep queueing them. This
+ * runs on the network thread.
+ */
+static void discard_legacy_messages() {
+    static SteamNetworkingMessage_t *buffer[100];
+
+    auto count = SteamNetworkingMessages()->ReceiveMessagesOnChannel(
+        steam_networking_channel_dyes_legacy, buffer, sizeof(buffer) / sizeof(buffer[0]));
+    for (auto &message : span{buffer, static_cast<size_t>(max(count, 0))}) {
+        message->Release();
+    }
+}
+
+/**
+ * Free the slots of players who aren't connected anymore. This runs on the network thread.
+ *
+ * @returns true if working_entries was changed
+ */
+static bool remove_disconnected_entries(const connected_players &players) {
+    auto steam_ids = span{players.steam_ids.data(), players.count};
+
+    bool changed = false;
+    for (auto &entry : working_entries) {
+        if (entry.steam_id != 0 &&
+            find(steam_ids.begin(), steam_ids.end(), entry.steam_id) == steam_ids.end()) {
+            entry = {};
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+void erdyes::net_players::init() {
+    palette_hash = dye_encoding::hash_palette(colors, intensities);
+    spdlog::info("Palette hash is {:08x}", palette_hash);
+
+    if (config::match_palette) {
+        palette_match::init();
+    }
+
+    network_thread = thread([]() {
+        while (!stop_network_thread.load(memory_order_relaxed)) {
+            bool changed = receive_messages();
+            discard_legacy_messages();
+
+            if (connected_player_snapshots.acquire()) {
+                changed |= remove_disconnected_entries(connected_player_snapshots.front());
+            }
+
+            if (changed) {
+                net_player_snapshots.back() = working_entries;
+                net_player_snapshots.publish();
+            }
+
+            // The session always includes the local player, so poll less often when offline
+            auto is_online = connected_player_snapshots.front().count > 1;
+            this_thread::sleep_for(is_online ? receive_interval : idle_receive_interval);
+        }
+    });
+}
+
+void erdyes::net_players::deinit() {
+    stop_network_thread.store(true, memory_order_relaxed);
+    if (network_thread.joinable()) {
+        network_thread.join();
+    }
+}
+
+void erdyes::net_players::update() {
+    static array<unsigned long long, max_net_players> previous_steam_ids{};
+
+    if (!net_player_snapshots.acquire()) {
+        return;
+    }
+
+    erdyes::state::generations.net_dyes++;
+
+    // Logging isn't thread safe, so report players joining and leaving from the game thread
+    auto &entries = net_player_snapshots.front();
+    uint64_t player_count = 0;
+    for (int i = 0; i < max_net_players; i++) {
+        auto steam_id = entries[i].steam_id;
+        if (steam_id != 0) {
+            player_count++;
+        }
+        if (steam_id != previous_steam_ids[i]) {
+            if (previous_steam_ids[i] != 0) {
+                spdlog::debug("Disconnected from user {}", previous_steam_ids[i]);
+            }
+            if (steam_id != 0) {
+                spdlog::debug("Received dye values from user {}", steam_id);
+            }
+            previous_steam_ids[i] = steam_id;
+        }
+    }
+
+    if (erdyes::config::telemetry) {
+        erdyes::telemetry::set(erdyes::telemetry::counters->net_players, player_count);
+    }
+}
+
+void erdyes::net_players::remove_disconnected_players() {
+    erdyes::trace::scope trace_scope{"net_players::remove_disconnected_players"};
+
+    auto &players = connected_player_snapshots.back();
+    players.count = 0;
+    for (auto &player_entry : er::CS::CSSessionManagerImp::instance()->player_entries()) {
+        if (players.count == players.steam_ids.size()) {
+            break;
+        }
+        players.steam_ids[players.count++] = player_entry.steam_id;
+    }
+
+    if (erdyes::capture::enabled) {
+        erdyes::capture::record_session(span{players.steam_ids.data(), players.count});
+    }
+
+    connected_player_snapshots.publish();
+}
+
+int erdyes::net_players::find_slot(unsigned long long steam_id, int hint) {
+    if (steam_id == 0) {
+        return -1;
+    }
+
+    auto &entries = net_player_snapshots.front();
+
+    if (hint >= 0 && hint < max_net_players && entries[hint].steam_id == steam_id) {
+        return hint;
+    }
+
+    for (int i = 0; i < max_net_players; i++) {
+        if (entries[i].steam_id == steam_id) {
+            return i;
         }
     }
+
+    return -1;
 }
 
-erdyes::state::dye_values erdyes::net_players::get_selected_dyes(unsigned long long steam_id) {
-    auto entry = net_colors_map.find(steam_id);
-    if (entry != net_colors_map.end()) {
-        return entry->second;
+const erdyes::state::dye_values &erdyes::net_players::get_selected_dyes(int slot) {
+    if (slot < 0 || slot >= max_net_players) {
+        return empty_dyes;
     }
 
-    return erdyes::state::dye_values{};
+    return net_player_snapshots.front()[slot].dyes;
 }
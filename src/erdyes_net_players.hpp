@@ -2,17 +2,42 @@
 
 #include "erdyes_dye_values.hpp"
 
+#include <array>
+
 namespace erdyes {
 namespace net_players {
 
-// Send messages to connected players containing this player's dye state
-void send_messages(const erdyes::state::dye_values &local_player_dyes);
+// Maximum number of other players whose dye state is tracked at once. Vanilla sessions have at
+// most 5 other players, but Seamless Co-op can raise the player cap.
+static constexpr int max_net_players = 64;
+
+// Start the thread that receives messages from other players syncing their dye state
+void init();
+
+// Stop the thread started by init() and wait for it to exit
+void deinit();
+
+// Switch to the latest dye state received from other players. This should be called once per
+// frame, and the results of get_selected_dyes() don't change until the next call.
+void update();
+
+// Send messages to connected players containing this player's dye state, either as values or as
+// indices into the palette depending on if they have the same palette
+void send_messages(const erdyes::state::dye_values &local_player_dyes,
+                   const std::array<int, 6> &local_player_indices);
+
+// Forget the dye state of players who aren't connected anymore
+void remove_disconnected_players();
 
-// Check for messages from other players syncing their dye state
-void receive_messages();
+/**
+ * @returns the slot storing the dye state sent by another player connected via Seamless Co-op, or
+ * -1 if none has been received. The slot of a player doesn't change while they're connected, so the
+ * result of a previous call can be passed as a hint to skip the search.
+ */
+int find_slot(unsigned long long steam_id, int hint = -1);
 
-// Get the dye state sent by another player connected via Seamless Co-op
-erdyes::state::dye_values get_selected_dyes(unsigned long long steam_id);
+// Get the dye state stored in a slot returned by find_slot(), or empty dyes for -1
+const erdyes::state::dye_values &get_selected_dyes(int slot);
 
 }
 }
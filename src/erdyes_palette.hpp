@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace erdyes {
+
+struct color {
+    // Menu text for the color. These are null-terminated, and point to strings owned by
+    // erdyes_local_player.cpp or mapped from the palette cache.
+    std::wstring_view color_block;
+    std::wstring_view selected_message;
+    std::wstring_view deselected_message;
+    float red;
+    float green;
+    float blue;
+    unsigned int animation_id;
+    int animation_index;
+};
+
+struct intensity {
+    std::wstring color_block;
+    std::wstring selected_message;
+    std::wstring deselected_message;
+    float intensity;
+};
+
+enum class dye_target_type : int {
+    none = -1,
+    primary_color,
+    secondary_color,
+    tertiary_color,
+    primary_intensity,
+    secondary_intensity,
+    tertiary_intensity,
+};
+
+}
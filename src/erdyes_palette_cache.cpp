@@ -0,0 +1,122 @@
+/**
+ * erdyes_palette_cache.cpp
+ *
+ * Binary cache of the color options parsed from the .ini file, including their pre-rendered menu
+ * messages. For very large palettes, mapping this file is much faster than parsing the .ini file,
+ * converting it to UTF-16, and formatting every message. The file stays mapped after it's loaded,
+ * and the color options point directly to the messages in it.
+ */
+#include "erdyes_palette_cache.hpp"
+#include "erdyes_local_player.hpp"
+#include "erdyes_palette_cache_format.hpp"
+
+#include <spdlog/spdlog.h>
+#include <fstream>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+using namespace std;
+using namespace erdyes::palette_cache;
+
+/**
+ * Validate the mapped cache file and add its colors
+ */
+static bool load_colors(span<const unsigned char> data, unsigned int config_hash) {
+    auto contents = cache_contents{};
+    if (!parse(data, config_hash, contents)) {
+        return false;
+    }
+
+    erdyes::colors.reserve(contents.colors.size());
+    for (auto &color : contents.colors) {
+        erdyes::local_player::add_prerendered_color_option(
+            contents.get_string(color.color_block), contents.get_string(color.selected_message),
+            contents.get_string(color.deselected_message), color.red, color.green, color.blue);
+    }
+
+    return true;
+}
+
+bool erdyes::palette_cache::load(const filesystem::path &cache_path, unsigned int config_hash) {
+    auto file = CreateFileW(cache_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    bool result = false;
+
+    LARGE_INTEGER file_size;
+    if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0) {
+        auto mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping) {
+            auto view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            if (view) {
+                result = load_colors(span{static_cast<const unsigned char *>(view),
+                                          static_cast<size_t>(file_size.QuadPart)},
+                                     config_hash);
+
+                // The loaded colors point into the view, so it's only unmapped if loading failed
+                if (!result) {
+                    UnmapViewOfFile(view);
+                }
+            }
+            CloseHandle(mapping);
+        }
+    }
+
+    CloseHandle(file);
+    return result;
+}
+
+void erdyes::palette_cache::save(const filesystem::path &cache_path, unsigned int config_hash) {
+    auto colors = vector<cache_color>{};
+    auto arena = wstring{};
+
+    auto add_string = [&](wstring_view str) {
+        auto result = cache_string{static_cast<unsigned int>(arena.size()),
+                                   static_cast<unsigned int>(str.size())};
+        arena += str;
+        arena += L'\0';
+        return result;
+    };
+
+    for (auto &color : erdyes::colors) {
+        // Animated colors need their lookup tables baked, so they're never cached
+        if (color.animation_index != -1) {
+            return;
+        }
+
+        colors.push_back({
+            .red = color.red,
+            .green = color.green,
+            .blue = color.blue,
+            .color_block = add_string(color.color_block),
+            .selected_message = add_string(color.selected_message),
+            .deselected_message = add_string(color.deselected_message),
+        });
+    }
+
+    auto header = cache_header{
+        .magic = cache_magic,
+        .version = cache_version,
+        .config_hash = config_hash,
+        .color_count = static_cast<unsigned int>(colors.size()),
+        .arena_size = static_cast<unsigned int>(arena.size()),
+    };
+
+    auto file = ofstream{cache_path, ios::binary | ios::trunc};
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(colors.data()), colors.size() * sizeof(cache_color));
+    file.write(reinterpret_cast<const char *>(arena.data()), arena.size() * sizeof(wchar_t));
+    if (!file) {
+        spdlog::warn("Failed to write palette cache {}", cache_path.string());
+        return;
+    }
+
+    spdlog::info("Saved {} colors to palette cache", colors.size());
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <filesystem>
+
+namespace erdyes {
+namespace palette_cache {
+
+/**
+ * Add the color options stored in the cache file, if it was saved from a config file with the
+ * given hash
+ *
+ * @returns true if the colors were loaded from the cache
+ */
+bool load(const std::filesystem::path &cache_path, unsigned int config_hash);
+
+/**
+ * Save the current color options to the cache file, along with the hash of the config file they
+ * were loaded from
+ */
+void save(const std::filesystem::path &cache_path, unsigned int config_hash);
+
+}
+}
@@ -0,0 +1,49 @@
+/**
+ * erdyes_palette_cache_format.cpp
+ *
+ * Validation of palette cache files, kept separate from the file mapping and color options so it
+ * can be fuzzed on any platform
+ */
+#include "erdyes_palette_cache_format.hpp"
+
+using namespace std;
+
+bool erdyes::palette_cache::parse(span<const unsigned char> data,
+                                  unsigned int config_hash,
+                                  cache_contents &contents) {
+    if (data.size() < sizeof(cache_header)) {
+        return false;
+    }
+
+    auto &header = *reinterpret_cast<const cache_header *>(data.data());
+    if (header.magic != cache_magic || header.version != cache_version ||
+        header.config_hash != config_hash) {
+        return false;
+    }
+
+    auto colors_size = static_cast<size_t>(header.color_count) * sizeof(cache_color);
+    auto arena_size = static_cast<size_t>(header.arena_size) * sizeof(wchar_t);
+    if (data.size() != sizeof(cache_header) + colors_size + arena_size) {
+        return false;
+    }
+
+    auto colors = span{reinterpret_cast<const cache_color *>(data.data() + sizeof(cache_header)),
+                       header.color_count};
+    auto arena = wstring_view{
+        reinterpret_cast<const wchar_t *>(data.data() + sizeof(cache_header) + colors_size),
+        header.arena_size};
+
+    auto is_valid = [&](const cache_string &str) {
+        return str.offset < arena.size() && str.size < arena.size() - str.offset &&
+               arena[str.offset + str.size] == L'\0';
+    };
+    for (auto &color : colors) {
+        if (!is_valid(color.color_block) || !is_valid(color.selected_message) ||
+            !is_valid(color.deselected_message)) {
+            return false;
+        }
+    }
+
+    contents = {.colors = colors, .arena = arena};
+    return true;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <span>
+#include <string_view>
+
+namespace erdyes {
+namespace palette_cache {
+
+static constexpr unsigned int cache_magic = 0x53455944;  // "DYES"
+static constexpr unsigned int cache_version = 2;
+
+struct cache_header {
+    unsigned int magic;
+    unsigned int version;
+    unsigned int config_hash;
+    unsigned int color_count;
+    unsigned int arena_size;
+};
+
+// Location of a string in the message arena, in characters. Each string is followed by a null
+// terminator, which isn't included in the size.
+struct cache_string {
+    unsigned int offset;
+    unsigned int size;
+};
+
+struct cache_color {
+    float red;
+    float green;
+    float blue;
+    cache_string color_block;
+    cache_string selected_message;
+    cache_string deselected_message;
+};
+
+/**
+ * The colors and message arena of a cache file, pointing into the file's data
+ */
+struct cache_contents {
+    std::span<const cache_color> colors;
+    std::wstring_view arena;
+
+    std::wstring_view get_string(const cache_string &str) const {
+        return arena.substr(str.offset, str.size);
+    }
+};
+
+/**
+ * Validate the contents of a cache file, which come straight from disk and aren't trusted
+ *
+ * @returns true if the data is a complete cache saved from a config file with the given hash, and
+ * every string is in bounds and null-terminated
+ */
+bool parse(std::span<const unsigned char> data, unsigned int config_hash, cache_contents &contents);
+
+}
+}
@@ -0,0 +1,198 @@
+/**
+ * erdyes_palette_match.cpp
+ *
+ * Maps arbitrary colors to the closest entry in the local palette, for players who want to see
+ * other players' dyes restricted to their own colors. Colors are compared in the OKLab perceptual
+ * color space, using a uniform grid so large palettes don't need a linear search.
+ */
+#include "erdyes_palette_match.hpp"
+#include "erdyes_config.hpp"
+#include "erdyes_local_player.hpp"
+#include "erdyes_telemetry.hpp"
+#include "erdyes_trace.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+using namespace std;
+
+typedef array<float, 3> lab_color;
+
+// Number of grid cells along each axis
+static constexpr int grid_size = 16;
+
+static vector<lab_color> points;
+static vector<int> point_color_indices;
+static vector<int> cell_starts;
+static lab_color grid_origin;
+static float cell_extent;
+
+struct cache_entry {
+    // 24-bit RGB value plus a flag in the high bits, or 0 if the entry is unused
+    unsigned int key;
+    int color_index;
+};
+
+static array<cache_entry, 4096> cache;
+static constexpr unsigned int cache_key_flag = 0x1000000;
+
+static float srgb_to_linear(float value) {
+    return value <= 0.04045f ? value / 12.92f : pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+/**
+ * Convert an sRGB color with 0-1 channels to OKLab
+ */
+static lab_color rgb_to_oklab(float red, float green, float blue) {
+    auto r = srgb_to_linear(red);
+    auto g = srgb_to_linear(green);
+    auto b = srgb_to_linear(blue);
+
+    auto l = cbrt(0.4122214708f * r + 0.5363325363f * g + 0.0514459929f * b);
+    auto m = cbrt(0.2119034982f * r + 0.6806995451f * g + 0.1073969566f * b);
+    auto s = cbrt(0.0883024619f * r + 0.2817188376f * g + 0.6299787005f * b);
+
+    return {
+        0.2104542553f * l + 0.7936177850f * m - 0.0040720468f * s,
+        1.9779984951f * l - 2.4285922050f * m + 0.4505937099f * s,
+        0.0259040371f * l + 0.7827717662f * m - 0.8086757660f * s,
+    };
+}
+
+static array<int, 3> get_cell(const lab_color &point) {
+    auto cell = array<int, 3>{};
+    for (int axis = 0; axis < 3; axis++) {
+        auto position = static_cast<int>((point[axis] - grid_origin[axis]) / cell_extent);
+        cell[axis] = clamp(position, 0, grid_size - 1);
+    }
+    return cell;
+}
+
+static int get_cell_index(const array<int, 3> &cell) {
+    return (cell[0] * grid_size + cell[1]) * grid_size + cell[2];
+}
+
+void erdyes::palette_match::init() {
+    erdyes::trace::scope trace_scope{"palette_match::init"};
+
+    auto unsorted_points = vector<lab_color>{};
+    auto unsorted_color_indices = vector<int>{};
+    for (size_t i = 0; i < erdyes::colors.size(); i++) {
+        auto &color = erdyes::colors[i];
+
+        // Only match static colors, since other players' colors shouldn't start animating
+        if (color.animation_index == -1) {
+            unsorted_points.push_back(rgb_to_oklab(color.red, color.green, color.blue));
+            unsorted_color_indices.push_back(i);
+        }
+    }
+
+    if (unsorted_points.empty()) {
+        return;
+    }
+
+    // Fit cubic cells around the palette
+    auto grid_min = unsorted_points[0];
+    auto grid_max = unsorted_points[0];
+    for (auto &point : unsorted_points) {
+        for (int axis = 0; axis < 3; axis++) {
+            grid_min[axis] = min(grid_min[axis], point[axis]);
+            grid_max[axis] = max(grid_max[axis], point[axis]);
+        }
+    }
+    grid_origin = grid_min;
+    cell_extent = max({grid_max[0] - grid_min[0], grid_max[1] - grid_min[1],
+                       grid_max[2] - grid_min[2], 0.001f}) /
+                  grid_size;
+
+    // Sort the points by cell, so each cell's points are contiguous
+    auto cell_counts = vector<int>(grid_size * grid_size * grid_size + 1);
+    for (auto &point : unsorted_points) {
+        cell_counts[get_cell_index(get_cell(point)) + 1]++;
+    }
+    cell_starts.resize(cell_counts.size());
+    for (size_t i = 1; i < cell_counts.size(); i++) {
+        cell_starts[i] = cell_starts[i - 1] + cell_counts[i];
+    }
+
+    auto cell_offsets = vector<int>(cell_starts.begin(), cell_starts.end() - 1);
+    points.resize(unsorted_points.size());
+    point_color_indices.resize(unsorted_points.size());
+    for (size_t i = 0; i < unsorted_points.size(); i++) {
+        auto position = cell_offsets[get_cell_index(get_cell(unsorted_points[i]))]++;
+        points[position] = unsorted_points[i];
+        point_color_indices[position] = unsorted_color_indices[i];
+    }
+}
+
+/**
+ * Search the grid in growing shells of cells around the query point, stopping once no unsearched
+ * cell could contain a closer point
+ */
+static int search_nearest(const lab_color &query) {
+    auto center = get_cell(query);
+    auto best_distance = numeric_limits<float>::infinity();
+    int best_index = -1;
+
+    for (int radius = 0; radius < grid_size; radius++) {
+        // Any point in this shell is at least (radius - 1) cells away from the query
+        auto min_shell_distance = max(0, radius - 1) * cell_extent;
+        if (min_shell_distance * min_shell_distance > best_distance) {
+            break;
+        }
+
+        for (int x = center[0] - radius; x <= center[0] + radius; x++) {
+            for (int y = center[1] - radius; y <= center[1] + radius; y++) {
+                for (int z = center[2] - radius; z <= center[2] + radius; z++) {
+                    // Only visit the surface of the shell
+                    if (max({abs(x - center[0]), abs(y - center[1]), abs(z - center[2])}) !=
+                        radius) {
+                        continue;
+                    }
+                    if (x < 0 || y < 0 || z < 0 || x >= grid_size || y >= grid_size ||
+                        z >= grid_size) {
+                        continue;
+                    }
+
+                    auto cell_index = get_cell_index({x, y, z});
+                    for (int i = cell_starts[cell_index]; i < cell_starts[cell_index + 1]; i++) {
+                        auto &point = points[i];
+                        auto dl = point[0] - query[0];
+                        auto da = point[1] - query[1];
+                        auto db = point[2] - query[2];
+                        auto distance = dl * dl + da * da + db * db;
+                        if (distance < best_distance) {
+                            best_distance = distance;
+                            best_index = point_color_indices[i];
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return best_index;
+}
+
+int erdyes::palette_match::find_nearest(unsigned char red, unsigned char green, unsigned char blue) {
+    if (points.empty()) {
+        return -1;
+    }
+
+    auto key = cache_key_flag | (red << 16) | (green << 8) | blue;
+    auto &entry = cache[(key * 2654435761u >> 20) % cache.size()];
+    if (entry.key != key) {
+        if (erdyes::config::telemetry) {
+            erdyes::telemetry::add(erdyes::telemetry::counters->palette_match_cache_misses);
+        }
+        auto query = rgb_to_oklab(red / 255.0f, green / 255.0f, blue / 255.0f);
+        entry = {key, search_nearest(query)};
+    } else if (erdyes::config::telemetry) {
+        erdyes::telemetry::add(erdyes::telemetry::counters->palette_match_cache_hits);
+    }
+
+    return entry.color_index;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+namespace erdyes {
+namespace palette_match {
+
+/**
+ * Build the spatial index of the local palette. This must be called after all colors are added,
+ * and before find_nearest() is used.
+ */
+void init();
+
+/**
+ * @returns the index of the local color that looks closest to the given 8-bit RGB color, or -1 if
+ * there aren't any static colors. Results are cached, so repeated lookups of the same color are a
+ * single table read.
+ */
+int find_nearest(unsigned char red, unsigned char green, unsigned char blue);
+
+}
+}
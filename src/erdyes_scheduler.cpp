@@ -0,0 +1,51 @@
+/**
+ * erdyes_scheduler.cpp
+ *
+ * Cooperative scheduler for work that doesn't need to happen in the same frame it's requested,
+ * such as sending network messages and clearing out stale state. This keeps the time the mod adds
+ * to a frame bounded even when a lot of work is requested at once.
+ */
+#include "erdyes_scheduler.hpp"
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <array>
+
+using namespace std;
+
+static array<erdyes::scheduler::task_fn *, 32> queue;
+static size_t queue_start = 0;
+static size_t queue_size = 0;
+
+void erdyes::scheduler::post(task_fn *task) {
+    for (size_t i = 0; i < queue_size; i++) {
+        if (queue[(queue_start + i) % queue.size()] == task) {
+            return;
+        }
+    }
+
+    if (queue_size == queue.size()) {
+        spdlog::warn("Task queue is full, running task immediately");
+        task();
+        return;
+    }
+
+    queue[(queue_start + queue_size) % queue.size()] = task;
+    queue_size++;
+}
+
+void erdyes::scheduler::run(chrono::microseconds budget) {
+    auto start_time = chrono::steady_clock::now();
+
+    do {
+        if (queue_size == 0) {
+            return;
+        }
+
+        auto task = queue[queue_start];
+        queue_start = (queue_start + 1) % queue.size();
+        queue_size--;
+
+        task();
+    } while (chrono::steady_clock::now() - start_time < budget);
+}
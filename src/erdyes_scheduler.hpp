@@ -0,0 +1,22 @@
+#pragma once
+
+#include <chrono>
+
+namespace erdyes {
+namespace scheduler {
+
+typedef void task_fn();
+
+/**
+ * Queue a task to run in an upcoming frame. A task that's already queued isn't queued again.
+ */
+void post(task_fn *);
+
+/**
+ * Run queued tasks until the given budget is spent, leaving the rest for the following frames. At
+ * least one task runs per call so the queue always makes progress.
+ */
+void run(std::chrono::microseconds budget);
+
+}
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+namespace erdyes {
+namespace state {
+
+/**
+ * Counters that increase whenever a piece of shared state changes. Consumers remember the
+ * generation they last processed and can skip their work if it hasn't changed.
+ */
+struct generation_counters {
+    // Available colors and intensities
+    unsigned int palette{0};
+    // Dye selections of the local player
+    unsigned int local_dyes{0};
+    // Dye states received from other players
+    unsigned int net_dyes{0};
+    // Translated menu messages
+    unsigned int messages{0};
+};
+
+inline generation_counters generations;
+
+}
+}
@@ -9,6 +9,7 @@
 #include "erdyes_talkscript.hpp"
 #include "erdyes_local_player.hpp"
 #include "erdyes_messages.hpp"
+#include "erdyes_trace.hpp"
 #include "talkscript_utils.hpp"
 
 #include <spdlog/spdlog.h>
@@ -313,6 +314,13 @@ static void ezstate_enter_state_detour(er::ezstate::state *state,
                                        er::ezstate::machine *machine,
                                        void *unk) {
     if (is_grace_state_group(machine->state_group)) {
+        erdyes::trace::scope trace_scope{"EzState::state::Enter"};
+
+        // Make sure the menu text is up to date before the grace menu is shown
+        if (state == machine->state_group->initial_state) {
+            erdyes::refresh_messages();
+        }
+
         if (state == machine->state_group->initial_state &&
             patch_state_group(machine->state_group)) {
             dye_target_menu.opts.back().transition.target_state =
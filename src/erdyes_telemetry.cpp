@@ -0,0 +1,111 @@
+/**
+ * erdyes_telemetry.cpp
+ *
+ * Exports counters to named shared memory, so overlays and monitoring tools can watch the mod
+ * without it having to log anything on the game thread.
+ */
+#include "erdyes_telemetry.hpp"
+
+#include <spdlog/spdlog.h>
+#include <new>
+
+#ifdef _WIN32
+#include <format>
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <cerrno>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+using erdyes::telemetry::counters_block;
+
+static counters_block local_counters;
+
+erdyes::telemetry::counters_block *erdyes::telemetry::counters = &local_counters;
+
+#ifdef _WIN32
+static void *map_shared_block(unsigned int process_id) {
+    auto name = format(L"Local\\erdyes_telemetry_{}", process_id);
+
+    // The mapping is kept open for the rest of the process, so readers can attach at any time
+    auto mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0,
+                                      sizeof(counters_block), name.c_str());
+    if (!mapping) {
+        spdlog::error("Failed to create telemetry shared memory: {}", GetLastError());
+        return nullptr;
+    }
+
+    auto view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(counters_block));
+    if (!view) {
+        spdlog::error("Failed to map telemetry shared memory: {}", GetLastError());
+        CloseHandle(mapping);
+        return nullptr;
+    }
+
+    return view;
+}
+#else
+static void *map_shared_block(unsigned int process_id) {
+    auto name = "/erdyes_telemetry_" + to_string(process_id);
+
+    // Unlike a Windows mapping, the object outlives the process, so replace any left over from an
+    // earlier process with the same ID
+    shm_unlink(name.c_str());
+    auto fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd == -1) {
+        spdlog::error("Failed to create telemetry shared memory: {}", errno);
+        return nullptr;
+    }
+
+    if (ftruncate(fd, sizeof(counters_block)) == -1) {
+        spdlog::error("Failed to size telemetry shared memory: {}", errno);
+        close(fd);
+        shm_unlink(name.c_str());
+        return nullptr;
+    }
+
+    auto view =
+        mmap(nullptr, sizeof(counters_block), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED) {
+        spdlog::error("Failed to map telemetry shared memory: {}", errno);
+        shm_unlink(name.c_str());
+        return nullptr;
+    }
+
+    return view;
+}
+#endif
+
+void erdyes::telemetry::init() {
+#ifdef _WIN32
+    unsigned int process_id = GetCurrentProcessId();
+#else
+    unsigned int process_id = getpid();
+#endif
+
+    auto view = map_shared_block(process_id);
+    if (!view) {
+        return;
+    }
+
+    auto block = new (view) counters_block{};
+    block->version = counters_version;
+    block->size = sizeof(counters_block);
+    block->process_id = process_id;
+
+    // Readers wait for the magic number before trusting the rest of the header
+    atomic_thread_fence(memory_order_release);
+    block->magic = counters_magic;
+
+    counters = block;
+    spdlog::info("Exporting telemetry to shared memory");
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace erdyes {
+namespace telemetry {
+
+static constexpr uint32_t counters_magic = 0x4d4c4554;  // "TELM"
+
+// Increased whenever fields are added, removed, or reordered
+static constexpr uint32_t counters_version = 1;
+
+/**
+ * Live counters that external tools can read from named shared memory. The layout is fixed for a
+ * given version. Each counter is updated on its own with relaxed atomics, so readers can poll
+ * without locking, but different counters aren't guaranteed to be consistent with each other.
+ */
+struct counters_block {
+    // Header, written once before the magic number is set
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;
+    uint32_t process_id;
+
+    // CS::PlayerIns::Update() detour calls, and the time spent in the detour excluding the
+    // original function
+    std::atomic<uint64_t> player_update_calls;
+    std::atomic<uint64_t> player_update_ns;
+
+    // GetEquipParamGoods() detour calls, and how many were for the dummy goods. The total is
+    // published once per frame, and may miss calls made from several threads at once.
+    std::atomic<uint64_t> goods_lookups;
+    std::atomic<uint64_t> dummy_goods_lookups;
+
+    // MsgRepositoryImp::LookupEntry() detour calls for messages added by the mod
+    std::atomic<uint64_t> message_lookups;
+
+    // Steam networking messages sent and received on the dye channel
+    std::atomic<uint64_t> messages_sent;
+    std::atomic<uint64_t> bytes_sent;
+    std::atomic<uint64_t> send_errors;
+    std::atomic<uint64_t> messages_received;
+    std::atomic<uint64_t> bytes_received;
+    std::atomic<uint64_t> messages_rejected;
+
+    // Number of other players whose dyes are currently known
+    std::atomic<uint64_t> net_players;
+
+    // Cache lookups of the net_players slot for each networked character
+    std::atomic<uint64_t> net_slot_cache_hits;
+    std::atomic<uint64_t> net_slot_cache_misses;
+
+    // Cache lookups of the nearest palette color for received dyes
+    std::atomic<uint64_t> palette_match_cache_hits;
+    std::atomic<uint64_t> palette_match_cache_misses;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "Counters in shared memory must not need a lock");
+
+/**
+ * The counters updated by the mod. Updates are skipped unless config::telemetry is set, so hot paths
+ * don't pay for a locked add when nobody is reading. This points to an unshared block until init()
+ * is called, so an update that races the config being loaded is still safe.
+ */
+extern counters_block *counters;
+
+/**
+ * Move the counters into named shared memory: "Local\erdyes_telemetry_<process ID>" on Windows, or
+ * the POSIX shared memory object "/erdyes_telemetry_<process ID>" elsewhere, for the Linux harness
+ */
+void init();
+
+inline void add(std::atomic<uint64_t> &counter, uint64_t value = 1) {
+    counter.fetch_add(value, std::memory_order_relaxed);
+}
+
+/**
+ * Increment a counter without a locked instruction, for paths too hot for add(). Increments from
+ * different threads at the same time can be lost.
+ */
+inline void add_unlocked(std::atomic<uint64_t> &counter) {
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+inline void set(std::atomic<uint64_t> &counter, uint64_t value) {
+    counter.store(value, std::memory_order_relaxed);
+}
+
+}
+}
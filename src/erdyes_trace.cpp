@@ -0,0 +1,144 @@
+/**
+ * erdyes_trace.cpp
+ *
+ * Optional timeline of the work done by the mod, for chasing hitches. Spans are recorded into a
+ * preallocated ring buffer and exported on demand as Chrome trace event JSON, which can be opened
+ * in Perfetto or chrome://tracing. The game thread only copies the buffer, and the file is written
+ * on a separate thread.
+ */
+#include "erdyes_trace.hpp"
+
+#include <spdlog/spdlog.h>
+#include <array>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+using namespace std;
+
+struct trace_event {
+    const char *name;
+    unsigned long thread_id;
+    long long start_us;
+    long long duration_us;
+};
+
+// Only the most recent events are kept, so tracing can be left on for a whole session
+static constexpr size_t max_trace_events = 1 << 16;
+static unique_ptr<array<trace_event, max_trace_events>> events;
+static atomic<unsigned long long> event_count{0};
+
+static chrono::steady_clock::time_point trace_start;
+static filesystem::path trace_output_path;
+
+void erdyes::trace::init(const filesystem::path &output_path) {
+    events = make_unique<array<trace_event, max_trace_events>>();
+    trace_start = chrono::steady_clock::now();
+    trace_output_path = output_path;
+    enabled = true;
+    spdlog::info("Tracing enabled, press F9 to save {}", output_path.filename().string());
+}
+
+void erdyes::trace::record(const char *name,
+                           chrono::steady_clock::time_point start,
+                           chrono::steady_clock::time_point end) {
+    // Events may be recorded from the game thread, the network thread, and the init thread, so
+    // each one claims its own slot. An event that's overwritten while it's being exported can
+    // come out garbled, which is acceptable for a debugging aid.
+    auto index = event_count.fetch_add(1, memory_order_relaxed) % max_trace_events;
+    (*events)[index] = {
+        .name = name,
+        .thread_id = GetCurrentThreadId(),
+        .start_us = chrono::duration_cast<chrono::microseconds>(start - trace_start).count(),
+        .duration_us = chrono::duration_cast<chrono::microseconds>(end - start).count(),
+    };
+}
+
+// Exports run on their own thread so writing the file doesn't hitch the game. spdlog isn't
+// thread-safe here, so the result is logged by update() once the export finishes.
+static thread export_thread;
+static atomic<bool> is_export_done{false};
+static bool export_succeeded = false;
+static size_t exported_event_count = 0;
+
+/**
+ * Copy the recorded events out of the ring buffer, oldest first
+ */
+static vector<trace_event> snapshot_events() {
+    auto count = event_count.load(memory_order_relaxed);
+    auto first = count > max_trace_events ? count - max_trace_events : 0;
+
+    auto snapshot = vector<trace_event>{};
+    snapshot.reserve(count - first);
+    for (auto i = first; i < count; i++) {
+        // Skip slots that were claimed but haven't been written yet
+        auto &event = (*events)[i % max_trace_events];
+        if (event.name) {
+            snapshot.push_back(event);
+        }
+    }
+    return snapshot;
+}
+
+/**
+ * Write a snapshot of the recorded events to the output file as Chrome trace event JSON. This
+ * runs on the export thread.
+ */
+static void export_trace(vector<trace_event> snapshot) {
+    auto process_id = GetCurrentProcessId();
+
+    auto file = ofstream{trace_output_path};
+    if (file) {
+        file << "{\"traceEvents\":[\n";
+        auto separator = "";
+        for (auto &event : snapshot) {
+            file << separator << "{\"name\":\"" << event.name
+                 << "\",\"ph\":\"X\",\"ts\":" << event.start_us
+                 << ",\"dur\":" << event.duration_us << ",\"pid\":" << process_id
+                 << ",\"tid\":" << event.thread_id << "}";
+            separator = ",\n";
+        }
+        file << "\n]}\n";
+    }
+
+    export_succeeded = file.good();
+    exported_event_count = snapshot.size();
+    is_export_done.store(true, memory_order_release);
+}
+
+void erdyes::trace::update() {
+    static bool was_key_down = false;
+
+    if (!enabled) {
+        return;
+    }
+
+    if (export_thread.joinable() && is_export_done.load(memory_order_acquire)) {
+        export_thread.join();
+        if (export_succeeded) {
+            spdlog::info("Saved {} trace events to {}", exported_event_count,
+                         trace_output_path.string());
+        } else {
+            spdlog::error("Failed to write {}", trace_output_path.string());
+        }
+    }
+
+    // Ignore the key while an export is still running
+    auto is_key_down = (GetAsyncKeyState(VK_F9) & 0x8000) != 0;
+    if (is_key_down && !was_key_down && !export_thread.joinable()) {
+        is_export_done.store(false, memory_order_relaxed);
+        export_thread = thread(export_trace, snapshot_events());
+    }
+    was_key_down = is_key_down;
+}
+
+void erdyes::trace::deinit() {
+    if (export_thread.joinable()) {
+        export_thread.join();
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+
+namespace erdyes {
+namespace trace {
+
+// Set by init() if tracing is turned on in the config
+inline bool enabled = false;
+
+/**
+ * Start recording trace events. Pressing F9 writes the recorded events to the given path.
+ */
+void init(const std::filesystem::path &output_path);
+
+/**
+ * Check if the export key is pressed. This is called once per frame from the game thread.
+ */
+void update();
+
+/**
+ * Wait for an export started by update() to finish
+ */
+void deinit();
+
+/**
+ * Record a completed span of work. The name must be a string literal, since it's stored by
+ * pointer.
+ */
+void record(const char *name,
+            std::chrono::steady_clock::time_point start,
+            std::chrono::steady_clock::time_point end);
+
+/**
+ * Records the time from construction to destruction as a span, if tracing is enabled
+ */
+class scope {
+public:
+    explicit scope(const char *name) : name(name) {
+        if (enabled) {
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~scope() {
+        if (enabled) {
+            record(name, start, std::chrono::steady_clock::now());
+        }
+    }
+
+    scope(const scope &) = delete;
+    scope &operator=(const scope &) = delete;
+
+private:
+    const char *name;
+    std::chrono::steady_clock::time_point start;
+};
+
+}
+}
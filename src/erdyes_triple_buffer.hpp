@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+
+namespace erdyes {
+
+/**
+ * Wait-free single producer, single consumer handoff of a value between two threads. The writer
+ * fills in back() and publishes it, and the reader switches to the latest published value with
+ * acquire(). Neither side ever blocks or sees a partially written value.
+ */
+template <typename T>
+class triple_buffer {
+public:
+    /**
+     * @returns the buffer the writer thread can fill in before calling publish()
+     */
+    T &back() { return buffers[back_index]; }
+
+    /**
+     * Make the contents of back() available to the reader thread
+     */
+    void publish() {
+        back_index = middle.exchange(back_index | dirty_bit, std::memory_order_acq_rel) & index_mask;
+    }
+
+    /**
+     * Switch front() to the latest published value, if any
+     *
+     * @returns true if a new value was published since the last call
+     */
+    bool acquire() {
+        if ((middle.load(std::memory_order_relaxed) & dirty_bit) == 0) {
+            return false;
+        }
+        front_index = middle.exchange(front_index, std::memory_order_acq_rel) & index_mask;
+        return true;
+    }
+
+    /**
+     * @returns the value the reader thread last acquired
+     */
+    const T &front() const { return buffers[front_index]; }
+
+private:
+    static constexpr unsigned int dirty_bit = 4;
+    static constexpr unsigned int index_mask = 3;
+
+    std::array<T, 3> buffers{};
+    unsigned int back_index{0};
+    std::atomic<unsigned int> middle{1};
+    unsigned int front_index{2};
+};
+
+}
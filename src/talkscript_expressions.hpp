@@ -0,0 +1,42 @@
+#pragma once
+
+#include <array>
+#include <cstring>
+#include <span>
+
+typedef std::array<unsigned char, 6> int_expression;
+
+/**
+ * Create an ESD expression representing a 4 byte integer
+ */
+static constexpr int_expression make_int_expression(int value) {
+    return {
+        0x82,
+        static_cast<unsigned char>((value & 0x000000ff)),
+        static_cast<unsigned char>((value & 0x0000ff00) >> 8),
+        static_cast<unsigned char>((value & 0x00ff0000) >> 16),
+        static_cast<unsigned char>((value & 0xff000000) >> 24),
+        0xa1,
+    };
+}
+
+/**
+ * Parse the bytes of an ESD expression containing only a 1 or 4 byte integer, or return -1 if
+ * it's anything else
+ */
+static int get_int_expression_value(std::span<const unsigned char> arg) {
+    // Single byte (plus final 0xa1) - used to store integers from -64 to 63
+    if (arg.size() == 2) {
+        return arg[0] - 64;
+    }
+
+    // Five bytes (plus final 0xa1) - used to store larger integers. The value isn't necessarily
+    // aligned, so copy it out instead of dereferencing it in place.
+    if (arg.size() == 6 && arg[0] == 0x82) {
+        int value;
+        std::memcpy(&value, &arg[1], sizeof(value));
+        return value;
+    }
+
+    return -1;
+}
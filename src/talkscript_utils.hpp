@@ -1,5 +1,7 @@
 #pragma once
 
+#include "talkscript_expressions.hpp"
+
 #include <elden-x/ezstate/ezstate.hpp>
 #include <elden-x/ezstate/talk_commands.hpp>
 
@@ -7,37 +9,11 @@
 #include <memory>
 #include <vector>
 
-typedef std::array<unsigned char, 6> int_expression;
-
-/**
- * Create an ESD expression representing a 4 byte integer
- */
-static constexpr int_expression make_int_expression(int value) {
-    return {
-        0x82,
-        static_cast<unsigned char>((value & 0x000000ff)),
-        static_cast<unsigned char>((value & 0x0000ff00) >> 8),
-        static_cast<unsigned char>((value & 0x00ff0000) >> 16),
-        static_cast<unsigned char>((value & 0xff000000) >> 24),
-        0xa1,
-    };
-}
-
 /**
  * Parse an ESD expression containing only a 1 or 4 byte integer
  */
 static int get_ezstate_int_value(const er::ezstate::expression arg) {
-    // Single byte (plus final 0xa1) - used to store integers from -64 to 63
-    if (arg.size() == 2) {
-        return arg[0] - 64;
-    }
-
-    // Five bytes (plus final 0xa1) - used to store larger integers
-    if (arg.size() == 6 && arg[0] == 0x82) {
-        return *reinterpret_cast<int *>(&arg[1]);
-    }
-
-    return -1;
+    return get_int_expression_value({arg.data(), arg.size()});
 }
 
 /**
@@ -0,0 +1,124 @@
+/**
+ * bench_apply_colors.cpp
+ *
+ * Compares writing a character's tint modifiers as one batch against the previous path, which
+ * searched the modifier vector and pushed back once per modifier.
+ */
+#include "erdyes_modifier_batch.hpp"
+
+#include <benchmark/benchmark.h>
+#include <array>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Same layout as CSChrModelParamModifierModule::modifier
+struct fake_modifier {
+    const wchar_t *name;
+    struct {
+        int material_id;
+        float value1;
+        float value2;
+        float value3;
+        float value4;
+        float value5;
+    } value;
+};
+
+static const wstring albedo1_material_ex_name = L"[Albedo]_1_[Tint]";
+static const wstring albedo2_material_ex_name = L"[Albedo]_2_[Tint]";
+static const wstring albedo3_material_ex_name = L"[Albedo]_3_[Tint]";
+static const wstring albedo4_material_ex_name = L"[Albedo]_4_[Tint]";
+
+static const array<const wstring *, erdyes::max_tint_modifiers> modifier_names = {
+    &albedo1_material_ex_name,
+    &albedo3_material_ex_name,
+    &albedo2_material_ex_name,
+    &albedo4_material_ex_name,
+};
+
+// Other modifiers the game applies to a character, which the search has to skip over
+static const array<wstring, 6> game_modifier_names = {
+    L"[Fur]_Color",   L"[Skin]_Color",  L"[Hair]_Color",
+    L"[Eye]_Color_L", L"[Eye]_Color_R", L"[Beard]_Color",
+};
+
+static vector<vector<fake_modifier>> make_characters(int count) {
+    auto characters = vector<vector<fake_modifier>>(count);
+    for (auto &modifiers : characters) {
+        for (auto &name : game_modifier_names) {
+            modifiers.push_back({.name = name.data(), .value = {}});
+        }
+    }
+    return characters;
+}
+
+static fake_modifier make_modifier(const wstring &name, float value) {
+    return {
+        .name = name.data(),
+        .value = {.material_id = 1,
+                  .value1 = value,
+                  .value2 = value,
+                  .value3 = value,
+                  .value4 = 1.0f,
+                  .value5 = value},
+    };
+}
+
+/**
+ * The previous path: build and write each modifier separately
+ */
+static void write_modifiers_separately(vector<fake_modifier> &modifiers, float value) {
+    auto apply_color = [&](const wstring &name) {
+        auto new_modifier = make_modifier(name, value);
+        for (auto &modifier : modifiers) {
+            if (modifier.name == name) {
+                modifier = new_modifier;
+                return;
+            }
+        }
+        modifiers.push_back(new_modifier);
+    };
+
+    for (auto name : modifier_names) {
+        apply_color(*name);
+    }
+}
+
+/**
+ * The current path: prepare every modifier up front and write them in one pass
+ */
+static void write_modifiers_batch(vector<fake_modifier> &modifiers, float value) {
+    alignas(16) array<fake_modifier, erdyes::max_tint_modifiers> new_modifiers;
+    for (size_t i = 0; i < new_modifiers.size(); i++) {
+        new_modifiers[i] = make_modifier(*modifier_names[i], value);
+    }
+
+    erdyes::write_modifiers(modifiers, new_modifiers, modifier_names, new_modifiers.size());
+}
+
+template <void (*write)(vector<fake_modifier> &, float)>
+static void bm_apply_colors(benchmark::State &state) {
+    auto characters = make_characters(static_cast<int>(state.range(0)));
+    float value = 0.0f;
+    for (auto _ : state) {
+        for (auto &modifiers : characters) {
+            write(modifiers, value);
+            benchmark::DoNotOptimize(modifiers.data());
+        }
+        value += 0.001f;
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(bm_apply_colors<write_modifiers_separately>)
+    ->Name("apply_colors/separate")
+    ->Arg(1)
+    ->Arg(4)
+    ->Arg(16);
+BENCHMARK(bm_apply_colors<write_modifiers_batch>)
+    ->Name("apply_colors/batch")
+    ->Arg(1)
+    ->Arg(4)
+    ->Arg(16);
@@ -0,0 +1,73 @@
+/**
+ * bench_goods_lookup.cpp
+ *
+ * Compares the check for dummy goods in the GetEquipParamGoods() hook against the previous check,
+ * which compared the ID against each of the six ranges. The miss path matters most, since almost
+ * every lookup is for a vanilla item.
+ */
+#include "erdyes_dummy_goods.hpp"
+
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+static constexpr unsigned int color_count = 15;
+static constexpr unsigned int intensity_count = 10;
+
+static const erdyes::dummy_goods::range_counts range_counts = {
+    color_count, color_count, color_count, intensity_count, intensity_count, intensity_count,
+};
+
+/**
+ * The previous check, with a two-sided comparison for each range
+ */
+static bool contains_by_range(int id) {
+    for (unsigned int i = 0; i < erdyes::dummy_goods::range_count; i++) {
+        auto range_start = erdyes::dummy_goods::start +
+                           static_cast<int>(i * erdyes::dummy_goods::range_size);
+        if (id >= range_start && id < range_start + static_cast<int>(range_counts[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool contains(int id) { return erdyes::dummy_goods::contains(id, range_counts); }
+
+/**
+ * Goods IDs spread over the vanilla ranges, or only the dummy goods
+ */
+static vector<int> make_ids(bool dummy) {
+    auto ids = vector<int>(4096);
+    auto rng = mt19937{1234};
+    for (auto &id : ids) {
+        if (dummy) {
+            auto range = rng() % erdyes::dummy_goods::range_count;
+            id = erdyes::dummy_goods::start + range * erdyes::dummy_goods::range_size +
+                 rng() % range_counts[range];
+        } else {
+            id = static_cast<int>(rng() % 2200000);
+        }
+    }
+    return ids;
+}
+
+template <bool (*check)(int), bool dummy>
+static void bm_goods_lookup(benchmark::State &state) {
+    auto ids = make_ids(dummy);
+    for (auto _ : state) {
+        int found = 0;
+        for (auto id : ids) {
+            found += check(id);
+        }
+        benchmark::DoNotOptimize(found);
+    }
+    state.SetItemsProcessed(state.iterations() * ids.size());
+}
+
+BENCHMARK(bm_goods_lookup<contains_by_range, false>)->Name("goods_lookup/miss/by_range");
+BENCHMARK(bm_goods_lookup<contains, false>)->Name("goods_lookup/miss");
+BENCHMARK(bm_goods_lookup<contains_by_range, true>)->Name("goods_lookup/hit/by_range");
+BENCHMARK(bm_goods_lookup<contains, true>)->Name("goods_lookup/hit");
@@ -0,0 +1,112 @@
+/**
+ * bench_message_lookup.cpp
+ *
+ * Measures the MsgRepositoryImp::LookupEntry() hook. Misses are vanilla messages, which only pay
+ * for the range check, and hits are spread over every message the mod adds.
+ */
+#include "erdyes_message_table.hpp"
+
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+static const wstring apply_dyes = L"Apply dyes";
+static const wstring none_deselected = L"None";
+static const wstring none_selected = L"<None>";
+static const wstring back = L"Back";
+
+static const array<wstring, 6> dye_target_messages = {
+    L"Primary color",     L"Secondary color",     L"Tertiary color",
+    L"Primary intensity", L"Secondary intensity", L"Tertiary intensity",
+};
+
+static vector<wstring> make_strings(size_t count, const wchar_t *prefix) {
+    auto strings = vector<wstring>{};
+    for (size_t i = 0; i < count; i++) {
+        strings.push_back(prefix + to_wstring(i));
+    }
+    return strings;
+}
+
+static const auto color_strings = make_strings(15, L"Color ");
+static const auto intensity_strings = make_strings(10, L"Intensity ");
+
+static vector<erdyes::color> make_colors() {
+    auto colors = vector<erdyes::color>{};
+    for (auto &str : color_strings) {
+        auto &color = colors.emplace_back();
+        color.color_block = str;
+        color.selected_message = str;
+        color.deselected_message = str;
+    }
+    return colors;
+}
+
+static vector<erdyes::intensity> make_intensities() {
+    auto intensities = vector<erdyes::intensity>{};
+    for (auto &str : intensity_strings) {
+        auto &intensity = intensities.emplace_back();
+        intensity.color_block = str;
+        intensity.selected_message = str;
+        intensity.deselected_message = str;
+    }
+    return intensities;
+}
+
+static const auto colors = make_colors();
+static const auto intensities = make_intensities();
+
+static const erdyes::message_table message_table = {
+    .apply_dyes = &apply_dyes,
+    .dye_target_messages = &dye_target_messages,
+    .none_deselected = &none_deselected,
+    .none_selected = &none_selected,
+    .back = &back,
+    .colors = &colors,
+    .intensities = &intensities,
+};
+
+static vector<int> make_message_ids(bool mod) {
+    namespace ids = erdyes::event_text_for_talk;
+
+    auto mod_ids =
+        vector<int>{ids::apply_dyes, ids::none_deselected, ids::none_selected, ids::back};
+    for (int i = ids::primary_color; i <= ids::tertiary_intensity; i++) {
+        mod_ids.push_back(i);
+    }
+    for (int i = 0; i < static_cast<int>(colors.size()); i++) {
+        mod_ids.push_back(ids::dye_color_selected_start + i);
+        mod_ids.push_back(ids::dye_color_deselected_start + i);
+    }
+    for (int i = 0; i < static_cast<int>(intensities.size()); i++) {
+        mod_ids.push_back(ids::dye_intensity_selected_start + i);
+        mod_ids.push_back(ids::dye_intensity_deselected_start + i);
+    }
+
+    auto msg_ids = vector<int>(4096);
+    auto rng = mt19937{1234};
+    for (auto &msg_id : msg_ids) {
+        msg_id = mod ? mod_ids[rng() % mod_ids.size()] : static_cast<int>(rng() % 100000000);
+    }
+    return msg_ids;
+}
+
+template <bool mod>
+static void bm_message_lookup(benchmark::State &state) {
+    auto msg_ids = make_message_ids(mod);
+    for (auto _ : state) {
+        for (auto msg_id : msg_ids) {
+            const wchar_t *message = nullptr;
+            if (erdyes::is_mod_message(msg_id)) {
+                message = erdyes::lookup_mod_message(message_table, msg_id);
+            }
+            benchmark::DoNotOptimize(message);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * msg_ids.size());
+}
+
+BENCHMARK(bm_message_lookup<false>)->Name("message_lookup/miss");
+BENCHMARK(bm_message_lookup<true>)->Name("message_lookup/hit");
@@ -0,0 +1,81 @@
+/**
+ * bench_net_encoding.cpp
+ *
+ * Measures encoding and decoding the dye messages sent to other players, in both the index format
+ * used between matching palettes and the value format used otherwise.
+ */
+#include "erdyes_dye_encoding.hpp"
+
+#include <benchmark/benchmark.h>
+#include <vector>
+
+using namespace std;
+
+static vector<erdyes::color> make_colors() {
+    auto colors = vector<erdyes::color>{};
+    for (int i = 0; i < 15; i++) {
+        auto &color = colors.emplace_back();
+        color.red = i / 15.0f;
+        color.green = 0.5f;
+        color.blue = 1.0f - i / 15.0f;
+    }
+    return colors;
+}
+
+static vector<erdyes::intensity> make_intensities() {
+    auto intensities = vector<erdyes::intensity>{};
+    for (int i = 0; i < 10; i++) {
+        intensities.emplace_back().intensity = 0.125f * (1 << i);
+    }
+    return intensities;
+}
+
+static const auto colors = make_colors();
+static const auto intensities = make_intensities();
+static const auto palette_hash = erdyes::dye_encoding::hash_palette(colors, intensities);
+
+static const array<int, 6> indices = {3, 7, -1, 4, 9, -1};
+
+static const erdyes::state::dye_values values = {
+    .primary = {true, 1.0f, 0.5f, 0.25f, 2.0f},
+    .secondary = {true, 0.0f, 0.2f, 0.8f, 0.5f},
+    .tertiary = {},
+};
+
+static void bm_encode_indices(benchmark::State &state) {
+    erdyes::dye_encoding::message_buffer buffer;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+            erdyes::dye_encoding::encode_indices(indices, palette_hash, buffer));
+        benchmark::ClobberMemory();
+    }
+}
+
+static void bm_encode_values(benchmark::State &state) {
+    erdyes::dye_encoding::message_buffer buffer;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(erdyes::dye_encoding::encode_values(values, palette_hash, buffer));
+        benchmark::ClobberMemory();
+    }
+}
+
+template <bool by_index>
+static void bm_decode(benchmark::State &state) {
+    erdyes::dye_encoding::message_buffer buffer;
+    auto size = by_index ? erdyes::dye_encoding::encode_indices(indices, palette_hash, buffer)
+                         : erdyes::dye_encoding::encode_values(values, palette_hash, buffer);
+    auto message = span<const unsigned char>{buffer.data(), size};
+
+    erdyes::state::dye_values decoded;
+    unsigned int sender_palette_hash;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(erdyes::dye_encoding::decode(
+            message, palette_hash, colors, intensities, decoded, sender_palette_hash));
+        benchmark::ClobberMemory();
+    }
+}
+
+BENCHMARK(bm_encode_indices)->Name("net_encoding/encode_indices");
+BENCHMARK(bm_encode_values)->Name("net_encoding/encode_values");
+BENCHMARK(bm_decode<true>)->Name("net_encoding/decode_indices");
+BENCHMARK(bm_decode<false>)->Name("net_encoding/decode_values");
@@ -0,0 +1,99 @@
+/**
+ * bench_palette_load.cpp
+ *
+ * Measures parsing the [colors] section of erdyes.ini, both the shipped palette and a large
+ * generated one. This covers the color parsers used by erdyes_config.cpp, but not formatting the
+ * menu messages, which depends on the game.
+ */
+#include "erdyes_color_parsing.hpp"
+
+#include <benchmark/benchmark.h>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+typedef vector<pair<string, string>> color_definitions;
+
+/**
+ * Read the name and value of every line in the [colors] section of the shipped erdyes.ini
+ */
+static color_definitions read_ini_colors() {
+    auto definitions = color_definitions{};
+    auto file = ifstream{ERDYES_INI_PATH};
+    bool in_colors_section = false;
+    for (string line; getline(file, line);) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.starts_with("[")) {
+            in_colors_section = line == "[colors]";
+        } else if (in_colors_section && !line.empty() && line[0] != ';') {
+            auto separator = line.find(" = ");
+            if (separator != string::npos) {
+                definitions.emplace_back(line.substr(0, separator), line.substr(separator + 3));
+            }
+        }
+    }
+    return definitions;
+}
+
+/**
+ * A large palette with a mix of static and animated colors
+ */
+static color_definitions make_colors(int count) {
+    static constexpr char hex_digits[] = "0123456789abcdef";
+    auto definitions = color_definitions{};
+    for (int i = 0; i < count; i++) {
+        auto hex_code = string{"#"};
+        for (int j = 0; j < 6; j++) {
+            hex_code += hex_digits[(i * 2654435761u >> (j * 4)) & 0xf];
+        }
+        if (i % 16 == 0) {
+            hex_code += " #ffffff 2.5";
+        }
+        definitions.emplace_back("Color " + to_string(i), hex_code);
+    }
+    return definitions;
+}
+
+static void parse_colors(const color_definitions &definitions) {
+    for (auto &[name, hex_code] : definitions) {
+        int elements[3];
+        vector<erdyes::animated_dyes::rgb> keyframes;
+        float period;
+        string display_hex_code;
+        if (erdyes::parse_hex_code(hex_code, elements)) {
+            benchmark::DoNotOptimize(elements);
+        } else if (erdyes::parse_animated_dye(hex_code, keyframes, period, display_hex_code)) {
+            benchmark::DoNotOptimize(erdyes::hash_string(hex_code));
+            benchmark::DoNotOptimize(keyframes.data());
+        }
+    }
+}
+
+static void bm_palette_load_ini(benchmark::State &state) {
+    auto definitions = read_ini_colors();
+    if (definitions.empty()) {
+        state.SkipWithError("Couldn't read the colors from " ERDYES_INI_PATH);
+        return;
+    }
+
+    for (auto _ : state) {
+        parse_colors(definitions);
+    }
+    state.SetItemsProcessed(state.iterations() * definitions.size());
+}
+
+static void bm_palette_load_generated(benchmark::State &state) {
+    auto definitions = make_colors(static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        parse_colors(definitions);
+    }
+    state.SetItemsProcessed(state.iterations() * definitions.size());
+}
+
+BENCHMARK(bm_palette_load_ini)->Name("palette_load/ini");
+BENCHMARK(bm_palette_load_generated)->Name("palette_load/generated")->Arg(1000);
@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+"""
+Compare Google Benchmark JSON results against the checked-in baseline, and fail if any benchmark
+got slower than its tolerance allows.
+
+    compare_bench.py bench_baseline.json bench_results.json
+    compare_bench.py bench_baseline.json bench_results.json --update
+
+The baseline maps each gated benchmark to its CPU time in nanoseconds, and optionally a tolerance
+(the allowed slowdown as a fraction) that overrides the default. --update rewrites the times in the
+baseline from the results, keeping the tolerances.
+"""
+
+import argparse
+import json
+import sys
+
+TIME_UNITS_NS = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+
+
+def read_results(path):
+    """
+    Returns the CPU time in nanoseconds of each benchmark. If the benchmarks were repeated, the
+    median is used.
+    """
+    with open(path) as file:
+        data = json.load(file)
+
+    times = {}
+    medians = {}
+    for benchmark in data["benchmarks"]:
+        if benchmark.get("error_occurred"):
+            continue
+        time = benchmark["cpu_time"] * TIME_UNITS_NS[benchmark.get("time_unit", "ns")]
+        name = benchmark.get("run_name", benchmark["name"])
+        if benchmark.get("run_type") == "aggregate":
+            if benchmark.get("aggregate_name") == "median":
+                medians[name] = time
+        else:
+            times.setdefault(name, time)
+
+    times.update(medians)
+    return times
+
+
+def format_time(ns):
+    if ns is None:
+        return "-"
+    for unit, scale in (("s", 1e9), ("ms", 1e6), ("us", 1e3)):
+        if ns >= scale:
+            return f"{ns / scale:.2f} {unit}"
+    return f"{ns:.2f} ns"
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("baseline")
+    parser.add_argument("results")
+    parser.add_argument("--update", action="store_true", help="rewrite the baseline times")
+    args = parser.parse_args()
+
+    with open(args.baseline) as file:
+        baseline = json.load(file)
+    results = read_results(args.results)
+
+    default_tolerance = baseline["default_tolerance"]
+    benchmarks = baseline["benchmarks"]
+
+    if args.update:
+        for name, entry in benchmarks.items():
+            if name in results:
+                entry["cpu_time_ns"] = round(results[name], 3)
+        with open(args.baseline, "w") as file:
+            json.dump(baseline, file, indent=2)
+            file.write("\n")
+        print(f"Updated {args.baseline}")
+        return 0
+
+    rows = []
+    failures = 0
+    for name, entry in benchmarks.items():
+        expected = entry["cpu_time_ns"]
+        tolerance = entry.get("tolerance", default_tolerance)
+        actual = results.get(name)
+        if actual is None:
+            change = "-"
+            status = "MISSING"
+            failures += 1
+        else:
+            ratio = actual / expected - 1.0
+            change = f"{ratio:+.1%}"
+            if ratio > tolerance:
+                status = "SLOWER"
+                failures += 1
+            elif ratio < -tolerance:
+                status = "faster"
+            else:
+                status = "ok"
+        rows.append((name, format_time(expected), format_time(actual), change, f"{tolerance:.0%}",
+                     status))
+
+    headers = ("Benchmark", "Baseline", "Current", "Change", "Tolerance", "Status")
+    widths = [max(len(row[i]) for row in rows + [headers]) for i in range(len(headers))]
+    print("  ".join(header.ljust(width) for header, width in zip(headers, widths)))
+    print("  ".join("-" * width for width in widths))
+    for row in rows:
+        print("  ".join(cell.ljust(width) for cell, width in zip(row, widths)))
+
+    ungated = sorted(set(results) - set(benchmarks))
+    if ungated:
+        print(f"\nNot in the baseline: {', '.join(ungated)}")
+
+    if failures:
+        print(f"\n{failures} benchmark(s) regressed or are missing")
+        return 1
+
+    print("\nNo regressions")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,73 @@
+/**
+ * Fake of the elden-x character types, with only the members the mod reads. The layout doesn't
+ * match the game; this just lets the mod's character code run on Linux.
+ */
+#pragma once
+
+#include <vector>
+
+namespace er {
+namespace CS {
+
+class CSChrModelParamModifierModule {
+public:
+    struct modifier {
+        const wchar_t *name;
+        struct {
+            int material_id;
+            float value1;
+            float value2;
+            float value3;
+            float value4;
+            float value5;
+        } value;
+    };
+
+    std::vector<modifier> modifiers;
+};
+
+class CSChrPhysicsModule {
+public:
+    struct {
+        float x;
+        float y;
+        float z;
+    } position;
+};
+
+class ChrIns {
+public:
+    struct chr_modules {
+        CSChrModelParamModifierModule *model_param_modifier_module;
+        CSChrPhysicsModule *physics_module;
+    };
+
+    chr_modules *modules;
+};
+
+class PlayerGameData {
+public:
+    struct {
+        struct {
+            struct {
+                int unused4;
+            } gear_param_ids;
+        } chr_asm;
+    } equip_game_data;
+};
+
+class PlayerIns : public ChrIns {
+public:
+    struct network_session_info {
+        unsigned long long steam_id;
+    };
+
+    PlayerGameData *game_data;
+
+    struct {
+        network_session_info *network_session;
+    } session_holder;
+};
+
+}
+}
@@ -0,0 +1,21 @@
+/**
+ * Fake of WorldChrManImp. The test sets fake_instance to control the main player.
+ */
+#pragma once
+
+#include "chr.hpp"
+
+namespace er {
+namespace CS {
+
+class WorldChrManImp {
+public:
+    static WorldChrManImp *instance() { return fake_instance; }
+
+    inline static WorldChrManImp *fake_instance = nullptr;
+
+    PlayerIns *main_player;
+};
+
+}
+}
@@ -0,0 +1,29 @@
+/**
+ * Fake of CSSessionManagerImp. The test fills in the player entries of fake_instance to control
+ * who's in the session.
+ */
+#pragma once
+
+#include <span>
+#include <vector>
+
+namespace er {
+namespace CS {
+
+class CSSessionManagerImp {
+public:
+    struct player_entry {
+        unsigned long long steam_id;
+    };
+
+    static CSSessionManagerImp *instance() { return fake_instance; }
+
+    inline static CSSessionManagerImp *fake_instance = nullptr;
+
+    std::span<const player_entry> player_entries() const { return entries; }
+
+    std::vector<player_entry> entries;
+};
+
+}
+}
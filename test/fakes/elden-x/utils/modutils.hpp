@@ -0,0 +1,42 @@
+/**
+ * Fake of the elden-x hooking utilities. Nothing is patched: hook() points the original function at
+ * a no-op and records the detour, so the test can call it with get_detour().
+ */
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace modutils {
+
+struct scanopts {
+    std::string aob;
+    std::ptrdiff_t offset;
+};
+
+template <typename function_type>
+inline function_type *fake_detour = nullptr;
+
+template <typename function_type>
+struct fake_original;
+
+template <typename return_type, typename... arg_types>
+struct fake_original<return_type(arg_types...)> {
+    static return_type call(arg_types...) { return return_type(); }
+};
+
+template <typename function_type>
+void hook(const scanopts &, function_type *detour, function_type *&original) {
+    fake_detour<function_type> = detour;
+    original = &fake_original<function_type>::call;
+}
+
+/**
+ * @returns the detour last passed to hook() for a function with the given signature
+ */
+template <typename function_type>
+function_type *get_detour() {
+    return fake_detour<function_type>;
+}
+
+}
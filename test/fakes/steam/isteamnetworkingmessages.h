@@ -0,0 +1,102 @@
+/**
+ * Fake of the Steamworks networking messages interface. Sent messages are only counted, and the
+ * test queues incoming messages with deliver(). It's safe to deliver messages from one thread while
+ * the mod receives them on another, like Steam.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <span>
+
+enum EResult {
+    k_EResultOK = 1,
+    k_EResultFail = 2,
+};
+
+static constexpr int k_nSteamNetworkingSend_Reliable = 8;
+
+class SteamNetworkingIdentity {
+public:
+    void SetSteamID(uint64_t steam_id) { this->steam_id = steam_id; }
+    uint64_t GetSteamID64() const { return steam_id; }
+
+private:
+    uint64_t steam_id{0};
+};
+
+class SteamNetworkingMessage_t {
+public:
+    SteamNetworkingIdentity m_identityPeer;
+
+    const void *GetData() const { return data; }
+    int GetSize() const { return size; }
+    void Release() {
+        delete[] data;
+        delete this;
+    }
+
+private:
+    friend class ISteamNetworkingMessages;
+
+    unsigned char *data;
+    int size;
+};
+
+class ISteamNetworkingMessages {
+public:
+    EResult SendMessageToUser(const SteamNetworkingIdentity &, const void *, uint32_t size, int,
+                              int) {
+        messages_sent.fetch_add(1, std::memory_order_relaxed);
+        bytes_sent.fetch_add(size, std::memory_order_relaxed);
+        return k_EResultOK;
+    }
+
+    int ReceiveMessagesOnChannel(int channel, SteamNetworkingMessage_t **messages, int max_count) {
+        auto lock = std::lock_guard{mutex};
+        int count = 0;
+        for (auto it = inbox.begin(); it != inbox.end() && count < max_count;) {
+            if (it->channel == channel) {
+                messages[count++] = it->message;
+                it = inbox.erase(it);
+            } else {
+                it++;
+            }
+        }
+        return count;
+    }
+
+    /**
+     * Queue a message from another player to be received by the mod
+     */
+    void deliver(uint64_t sender_steam_id, int channel, std::span<const unsigned char> data) {
+        auto message = new SteamNetworkingMessage_t{};
+        message->m_identityPeer.SetSteamID(sender_steam_id);
+        message->data = new unsigned char[data.size()];
+        message->size = static_cast<int>(data.size());
+        memcpy(message->data, data.data(), data.size());
+
+        auto lock = std::lock_guard{mutex};
+        inbox.push_back({channel, message});
+    }
+
+    std::atomic<uint64_t> messages_sent{0};
+    std::atomic<uint64_t> bytes_sent{0};
+
+private:
+    struct queued_message {
+        int channel;
+        SteamNetworkingMessage_t *message;
+    };
+
+    std::mutex mutex;
+    std::deque<queued_message> inbox;
+};
+
+inline ISteamNetworkingMessages *SteamNetworkingMessages() {
+    static ISteamNetworkingMessages instance;
+    return &instance;
+}
@@ -0,0 +1,27 @@
+/**
+ * Fake of the Steamworks user interface. The test sets fake_steam_id to the local player's ID.
+ */
+#pragma once
+
+#include <cstdint>
+
+class CSteamID {
+public:
+    explicit CSteamID(uint64_t steam_id) : steam_id(steam_id) {}
+    uint64_t ConvertToUint64() const { return steam_id; }
+
+private:
+    uint64_t steam_id;
+};
+
+class ISteamUser {
+public:
+    CSteamID GetSteamID() const { return CSteamID{fake_steam_id}; }
+
+    uint64_t fake_steam_id{0};
+};
+
+inline ISteamUser *SteamUser() {
+    static ISteamUser instance;
+    return &instance;
+}
@@ -0,0 +1,23 @@
+/**
+ * Fake of the few Win32 functions the portable parts of the mod call
+ */
+#pragma once
+
+#include <pthread.h>
+#include <unistd.h>
+
+#define VK_F8 0x77
+#define VK_F9 0x78
+
+inline unsigned long GetCurrentThreadId() {
+    return static_cast<unsigned long>(pthread_self());
+}
+
+inline unsigned long GetCurrentProcessId() {
+    return static_cast<unsigned long>(getpid());
+}
+
+// No keys are ever pressed
+inline short GetAsyncKeyState(int) {
+    return 0;
+}
@@ -0,0 +1,111 @@
+/**
+ * fuzz_decode.cpp
+ *
+ * libFuzzer target for the code that reads untrusted bytes: the dye wire decoder (peer messages),
+ * the settings scanner and color parsers (erdyes.ini), the palette cache validation
+ * (erdyes_palette.bin), and the ESD integer reader (talkscript events). Every input is passed to
+ * each of them, since they're all cheap to reject.
+ */
+#include "erdyes_color_parsing.hpp"
+#include "erdyes_dye_encoding.hpp"
+#include "erdyes_ini_settings.hpp"
+#include "erdyes_palette_cache_format.hpp"
+#include "talkscript_expressions.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static vector<erdyes::color> make_colors() {
+    auto colors = vector<erdyes::color>{};
+    for (int i = 0; i < 15; i++) {
+        auto &color = colors.emplace_back();
+        color.red = i / 15.0f;
+        color.green = 0.5f;
+        color.blue = 1.0f - i / 15.0f;
+    }
+    return colors;
+}
+
+static vector<erdyes::intensity> make_intensities() {
+    auto intensities = vector<erdyes::intensity>{};
+    for (int i = 0; i < 10; i++) {
+        intensities.emplace_back().intensity = 0.125f * (1 << i);
+    }
+    return intensities;
+}
+
+static const auto colors = make_colors();
+static const auto intensities = make_intensities();
+static const auto palette_hash = erdyes::dye_encoding::hash_palette(colors, intensities);
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    auto message = span<const unsigned char>{data, size};
+
+    erdyes::state::dye_values values;
+    unsigned int sender_palette_hash;
+    erdyes::dye_encoding::decode(message, palette_hash, colors, intensities, values,
+                                 sender_palette_hash);
+
+    // Also decode as if the sender's palette matched, so index messages reach the bounds checks
+    // without the fuzzer having to guess the hash
+    if (size >= 2 + sizeof(unsigned int)) {
+        unsigned int message_palette_hash;
+        memcpy(&message_palette_hash, data + 2, sizeof(message_palette_hash));
+        erdyes::dye_encoding::decode(message, message_palette_hash, colors, intensities, values,
+                                     sender_palette_hash);
+    }
+
+    // Parse every setting value as a color too, so the erdyes.ini seeds reach the color parsers
+    // through the scanner as well as directly
+    auto str = string{reinterpret_cast<const char *>(data), size};
+    int elements[3];
+    erdyes::read_ini_settings(str, [&](string_view, string_view key, string_view value) {
+        erdyes::parse_hex_code(key, elements);
+        erdyes::parse_hex_code(value, elements);
+    });
+    erdyes::parse_hex_code(str, elements);
+
+    vector<erdyes::animated_dyes::rgb> keyframes;
+    float period;
+    string display_hex_code;
+    if (erdyes::parse_animated_dye(str, keyframes, period, display_hex_code)) {
+        erdyes::parse_hex_code(display_hex_code, elements);
+    }
+
+    // Check the cache both against a fixed hash and the hash it claims, so the fuzzer doesn't
+    // have to guess it to reach the string validation
+    auto contents = erdyes::palette_cache::cache_contents{};
+    auto parse_cache = [&](unsigned int config_hash) {
+        if (erdyes::palette_cache::parse(message, config_hash, contents)) {
+            for (auto &color : contents.colors) {
+                auto color_block = contents.get_string(color.color_block);
+                auto selected_message = contents.get_string(color.selected_message);
+                auto deselected_message = contents.get_string(color.deselected_message);
+
+                // Strings are used as null-terminated by the game, so read through the terminator
+                volatile wchar_t terminator = color_block.data()[color_block.size()] +
+                                              selected_message.data()[selected_message.size()] +
+                                              deselected_message.data()[deselected_message.size()];
+                (void)terminator;
+            }
+        }
+    };
+    parse_cache(palette_hash);
+    if (size >= offsetof(erdyes::palette_cache::cache_header, config_hash) + sizeof(unsigned int)) {
+        unsigned int cache_config_hash;
+        memcpy(&cache_config_hash,
+               data + offsetof(erdyes::palette_cache::cache_header, config_hash),
+               sizeof(cache_config_hash));
+        parse_cache(cache_config_hash);
+    }
+
+    get_int_expression_value(message);
+
+    return 0;
+}
@@ -0,0 +1,326 @@
+/**
+ * replay.cpp
+ *
+ * Replays inputs recorded with capture = true in erdyes.ini through the portable parts of the mod.
+ * Received messages are decoded with dye_encoding into the same flat table net_players keeps, and
+ * handed to the game thread side with a triple_buffer. Every character's tint modifiers are then
+ * written with write_modifiers into a vector the size the game had. Frames run back to back, and
+ * the report gives the cost of the network and game thread work in each frame.
+ *
+ *   erdyes_replay <capture file>
+ */
+#include "erdyes_capture_format.hpp"
+#include "erdyes_dye_encoding.hpp"
+#include "erdyes_modifier_batch.hpp"
+#include "erdyes_triple_buffer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Same as max_net_players in erdyes_net_players.hpp
+static constexpr int max_net_players = 64;
+
+// Same layout as CSChrModelParamModifierModule::modifier
+struct fake_modifier {
+    const wchar_t *name;
+    struct {
+        int material_id;
+        float value1;
+        float value2;
+        float value3;
+        float value4;
+        float value5;
+    } value;
+};
+
+static const wstring albedo1_material_ex_name = L"[Albedo]_1_[Tint]";
+static const wstring albedo2_material_ex_name = L"[Albedo]_2_[Tint]";
+static const wstring albedo3_material_ex_name = L"[Albedo]_3_[Tint]";
+static const wstring albedo4_material_ex_name = L"[Albedo]_4_[Tint]";
+
+// Stand-in for the other modifiers the game applies to a character, which the mod has to skip over
+static const wstring game_modifier_name = L"[Skin]_Color";
+
+struct net_player_entry {
+    unsigned long long steam_id{0};
+    unsigned int palette_hash{0};
+    erdyes::state::dye_values dyes;
+};
+
+typedef array<net_player_entry, max_net_players> net_player_table;
+
+static vector<erdyes::color> colors;
+static vector<erdyes::intensity> intensities;
+static unsigned int palette_hash;
+
+static net_player_table working_entries;
+static erdyes::triple_buffer<net_player_table> net_player_snapshots;
+static erdyes::state::dye_values local_dyes;
+
+// Modifier vectors of the characters dyed each frame, in the order they were dyed
+static vector<vector<fake_modifier>> characters;
+
+/**
+ * Decode a received message into working_entries, like receive_messages()
+ *
+ * @returns true if working_entries was changed
+ */
+static bool receive_message(unsigned long long steam_id, span<const unsigned char> message) {
+    auto entry = find_if(working_entries.begin(), working_entries.end(),
+                         [&](auto &other) { return other.steam_id == steam_id; });
+    if (entry == working_entries.end()) {
+        entry = find_if(working_entries.begin(), working_entries.end(),
+                        [](auto &other) { return other.steam_id == 0; });
+    }
+    if (steam_id == 0 || entry == working_entries.end()) {
+        return false;
+    }
+
+    erdyes::state::dye_values dyes;
+    unsigned int sender_palette_hash;
+    if (!erdyes::dye_encoding::decode(message, palette_hash, colors, intensities, dyes,
+                                      sender_palette_hash)) {
+        return false;
+    }
+
+    entry->steam_id = steam_id;
+    entry->palette_hash = sender_palette_hash;
+    entry->dyes = dyes;
+    return true;
+}
+
+/**
+ * Free the slots of players who left the session, like remove_disconnected_entries()
+ *
+ * @returns true if working_entries was changed
+ */
+static bool remove_disconnected_entries(const erdyes::capture::record &session) {
+    bool changed = false;
+    for (auto &entry : working_entries) {
+        if (entry.steam_id == 0) {
+            continue;
+        }
+
+        bool is_connected = false;
+        for (size_t i = 0; i < session.get_session_size() && !is_connected; i++) {
+            is_connected = session.get_session_steam_id(i) == entry.steam_id;
+        }
+        if (!is_connected) {
+            entry = {};
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+static void set_local_indices(const array<int, 6> &indices) {
+    auto is_valid = [](int index, size_t size) { return index >= 0 && index < (int)size; };
+
+    auto targets = array{&local_dyes.primary, &local_dyes.secondary, &local_dyes.tertiary};
+    for (size_t i = 0; i < targets.size(); i++) {
+        auto &value = *targets[i];
+        if (is_valid(indices[i], colors.size())) {
+            auto &color = colors[indices[i]];
+            value.is_applied = true;
+            value.red = color.red;
+            value.green = color.green;
+            value.blue = color.blue;
+            value.intensity = is_valid(indices[i + 3], intensities.size())
+                                  ? intensities[indices[i + 3]].intensity
+                                  : 1.0f;
+        } else {
+            value.is_applied = false;
+        }
+    }
+}
+
+static const erdyes::state::dye_values &get_dyes(unsigned long long steam_id) {
+    static const erdyes::state::dye_values empty_dyes{};
+
+    if (steam_id == 0) {
+        return local_dyes;
+    }
+
+    for (auto &entry : net_player_snapshots.front()) {
+        if (entry.steam_id == steam_id) {
+            return entry.dyes;
+        }
+    }
+    return empty_dyes;
+}
+
+/**
+ * Write the tint modifiers for a character's dyes, like apply_colors()
+ */
+static void apply_colors(vector<fake_modifier> &modifiers, const erdyes::state::dye_values &values) {
+    alignas(16) array<fake_modifier, erdyes::max_tint_modifiers> new_modifiers;
+    array<const wstring *, erdyes::max_tint_modifiers> new_modifier_names;
+    size_t count = 0;
+
+    auto add_modifier = [&](const wstring &name, const erdyes::state::dye_value &value) {
+        new_modifier_names[count] = &name;
+        new_modifiers[count++] = {
+            .name = name.data(),
+            .value = {.material_id = 1,
+                      .value1 = value.red,
+                      .value2 = value.green,
+                      .value3 = value.blue,
+                      .value4 = 1.0f,
+                      .value5 = value.intensity},
+        };
+    };
+
+    if (values.primary.is_applied) {
+        add_modifier(albedo1_material_ex_name, values.primary);
+    }
+    if (values.secondary.is_applied) {
+        add_modifier(albedo3_material_ex_name, values.secondary);
+    }
+    if (values.tertiary.is_applied) {
+        add_modifier(albedo2_material_ex_name, values.tertiary);
+        add_modifier(albedo4_material_ex_name, values.tertiary);
+    }
+
+    erdyes::write_modifiers(modifiers, new_modifiers, new_modifier_names, count);
+}
+
+static double get_percentile(const vector<double> &sorted_values, double percentile) {
+    auto index = static_cast<size_t>(percentile / 100.0 * (sorted_values.size() - 1) + 0.5);
+    return sorted_values[index];
+}
+
+static void print_percentiles(const char *name, vector<double> &times) {
+    sort(times.begin(), times.end());
+    printf("  %-24s p50 %.2f  p90 %.2f  p99 %.2f  max %.2f\n", name, get_percentile(times, 50),
+           get_percentile(times, 90), get_percentile(times, 99), times.back());
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <capture file>\n", argv[0]);
+        return 1;
+    }
+
+    auto file = ifstream{argv[1], ios::binary};
+    auto data = vector<unsigned char>{istreambuf_iterator<char>{file}, {}};
+    if (!file) {
+        fprintf(stderr, "Failed to read %s\n", argv[1]);
+        return 1;
+    }
+
+    auto reader = erdyes::capture::reader{data};
+    if (!reader.read_header(colors, intensities)) {
+        fprintf(stderr, "%s isn't a capture from this version of the mod\n", argv[1]);
+        return 1;
+    }
+    palette_hash = erdyes::dye_encoding::hash_palette(colors, intensities);
+
+    // Messages and session changes are handled by the network thread in the mod, so their cost is
+    // reported separately from the game thread's
+    auto net_times = vector<double>{};
+    auto game_times = vector<double>{};
+    double net_time = 0.0;
+    double game_time = 0.0;
+    bool changed = false;
+    size_t character_index = 0;
+    size_t message_count = 0;
+    size_t character_count = 0;
+    size_t menu_frame_count = 0;
+    int focused_entry = -1;
+    double capture_seconds = 0.0;
+
+    auto end_frame = [&]() {
+        if (changed) {
+            auto start_time = chrono::steady_clock::now();
+            net_player_snapshots.back() = working_entries;
+            net_player_snapshots.publish();
+            net_time += chrono::duration<double, micro>(chrono::steady_clock::now() - start_time)
+                            .count();
+            changed = false;
+        }
+
+        net_times.push_back(net_time);
+        game_times.push_back(game_time);
+        net_time = 0.0;
+        game_time = 0.0;
+    };
+
+    erdyes::capture::record record;
+    bool has_frame = false;
+    while (reader.next(record)) {
+        auto start_time = chrono::steady_clock::now();
+        auto is_net_record = false;
+
+        switch (record.type) {
+            case erdyes::capture::record_type::frame:
+                if (has_frame) {
+                    end_frame();
+                }
+                has_frame = true;
+                capture_seconds += record.delta_time;
+                character_index = 0;
+                menu_frame_count += focused_entry != -1;
+                start_time = chrono::steady_clock::now();
+                net_player_snapshots.acquire();
+                break;
+            case erdyes::capture::record_type::local_indices:
+                set_local_indices(record.indices);
+                break;
+            case erdyes::capture::record_type::focused_entry:
+                focused_entry = record.focused_entry;
+                break;
+            case erdyes::capture::record_type::message:
+                is_net_record = true;
+                message_count++;
+                changed |= receive_message(record.steam_id, record.message);
+                break;
+            case erdyes::capture::record_type::session:
+                is_net_record = true;
+                changed |= remove_disconnected_entries(record);
+                break;
+            case erdyes::capture::record_type::character: {
+                if (character_index == characters.size()) {
+                    characters.emplace_back();
+                }
+
+                // The game's own modifiers aren't recorded, so fill the vector up to the recorded
+                // size with stand-ins
+                auto &modifiers = characters[character_index++];
+                modifiers.resize(min<size_t>(modifiers.size(), record.modifier_count));
+                while (modifiers.size() < record.modifier_count) {
+                    modifiers.push_back({.name = game_modifier_name.data(), .value = {}});
+                }
+
+                apply_colors(modifiers, get_dyes(record.steam_id));
+                character_count++;
+                break;
+            }
+        }
+
+        auto elapsed =
+            chrono::duration<double, micro>(chrono::steady_clock::now() - start_time).count();
+        (is_net_record ? net_time : game_time) += elapsed;
+    }
+
+    if (!has_frame) {
+        fprintf(stderr, "%s doesn't have any frames\n", argv[1]);
+        return 1;
+    }
+    end_frame();
+
+    printf("%zu frames (%.1f seconds), %zu messages, %zu characters dyed, %zu frames in the menu\n",
+           game_times.size(), capture_seconds, message_count, character_count, menu_frame_count);
+    printf("Time per frame (us)\n");
+    print_percentiles("network thread", net_times);
+    print_percentiles("game thread", game_times);
+
+    return 0;
+}
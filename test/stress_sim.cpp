@@ -0,0 +1,320 @@
+/**
+ * stress_sim.cpp
+ *
+ * Simulates a large Seamless Co-op session to find where the mod stops scaling. The real
+ * net_players and apply_materials code runs against the fake session manager, Steam interface,
+ * and characters in fakes/, while every other player changes their dyes at random and sends them
+ * the same way the mod does. Frames are paced at 60 FPS so the network thread sees messages at a
+ * realistic rate.
+ *
+ *   erdyes_stress_sim <other player count> [frame count] [capture file]
+ *
+ * If a capture file is given, the session is also recorded to it like capture = true in
+ * erdyes.ini, so it can be replayed with erdyes_replay.
+ */
+#include "erdyes_apply_materials.hpp"
+#include "erdyes_capture.hpp"
+#include "erdyes_config.hpp"
+#include "erdyes_dye_encoding.hpp"
+#include "erdyes_local_player.hpp"
+#include "erdyes_net_players.hpp"
+#include "erdyes_state.hpp"
+
+#include <elden-x/chr/world_chr_man.hpp>
+#include <elden-x/session.hpp>
+#include <elden-x/utils/modutils.hpp>
+#include <steam/isteamnetworkingmessages.h>
+#include <steam/isteamuser.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+bool erdyes::config::debug = false;
+unsigned int erdyes::config::initialize_delay = 0;
+bool erdyes::config::client_side_only = false;
+bool erdyes::config::cache_palette = false;
+bool erdyes::config::match_palette = false;
+int erdyes::config::intensity_count = 10;
+float erdyes::config::intensity_min = 0.125f;
+float erdyes::config::intensity_max = 64.0f;
+bool erdyes::config::intensity_exponential = true;
+bool erdyes::config::telemetry = false;
+bool erdyes::config::trace = false;
+float erdyes::config::cull_distance = 0.0f;
+
+vector<erdyes::color> erdyes::colors;
+vector<erdyes::intensity> erdyes::intensities;
+
+// Same as steam_networking_channel_dyes in erdyes_net_players.cpp
+static constexpr int steam_networking_channel_dyes = 100068;
+
+static constexpr float delta_time = 1.0f / 60.0f;
+
+// Players send their dyes this often, and resend them every this many sends even if they didn't
+// change, like send_local_player_dyes()
+static constexpr float send_interval = 0.1f;
+static constexpr int resync_interval_sends = 10;
+
+// Chance of a player picking new dyes each frame, about once every 5 seconds
+static constexpr float change_chance = 1.0f / 300.0f;
+
+// Other modifiers the game applies to a character, which the mod has to skip over
+static const array<wstring, 6> game_modifier_names = {
+    L"[Fur]_Color",   L"[Skin]_Color",  L"[Hair]_Color",
+    L"[Eye]_Color_L", L"[Eye]_Color_R", L"[Beard]_Color",
+};
+
+static mt19937 rng{12345};
+
+/**
+ * A character owned by the simulation, with everything the mod reads from it
+ */
+struct sim_character {
+    er::CS::PlayerIns player{};
+    er::CS::ChrIns::chr_modules modules{};
+    er::CS::CSChrModelParamModifierModule modifier_module;
+    er::CS::CSChrPhysicsModule physics_module{};
+    er::CS::PlayerGameData game_data{};
+    er::CS::PlayerIns::network_session_info network_session{};
+
+    explicit sim_character(unsigned long long steam_id) {
+        for (auto &name : game_modifier_names) {
+            modifier_module.modifiers.push_back({.name = name.data(), .value = {}});
+        }
+        modules.model_param_modifier_module = &modifier_module;
+        modules.physics_module = &physics_module;
+        player.modules = &modules;
+        player.game_data = &game_data;
+        network_session.steam_id = steam_id;
+        player.session_holder.network_session = steam_id != 0 ? &network_session : nullptr;
+    }
+};
+
+/**
+ * Another player in the session, who picks dyes from either the same palette or a different one
+ */
+struct sim_player {
+    unique_ptr<sim_character> character;
+    unsigned long long steam_id;
+    bool has_same_palette;
+    array<int, 6> indices{-1, -1, -1, -1, -1, -1};
+    bool changed{false};
+    float send_time{0.0f};
+    int sends_until_resync{0};
+};
+
+static array<int, 6> random_indices() {
+    auto color = uniform_int_distribution<int>{-1, static_cast<int>(erdyes::colors.size()) - 1};
+    auto intensity =
+        uniform_int_distribution<int>{0, static_cast<int>(erdyes::intensities.size()) - 1};
+    return {color(rng), color(rng), color(rng), intensity(rng), intensity(rng), intensity(rng)};
+}
+
+static erdyes::state::dye_values get_dye_values(const array<int, 6> &indices) {
+    auto values = erdyes::state::dye_values{};
+    auto targets = array{&values.primary, &values.secondary, &values.tertiary};
+    for (size_t i = 0; i < targets.size(); i++) {
+        if (indices[i] != -1) {
+            auto &color = erdyes::colors[indices[i]];
+            *targets[i] = {
+                .is_applied = true,
+                .red = color.red,
+                .green = color.green,
+                .blue = color.blue,
+                .intensity = erdyes::intensities[indices[i + 3]].intensity,
+            };
+        }
+    }
+    return values;
+}
+
+// The local player's selections, which local_player::update() would read from the inventory
+static array<int, 6> local_indices{-1, -1, -1, -1, -1, -1};
+static erdyes::state::dye_values local_dyes;
+
+void erdyes::local_player::update() {
+    if (uniform_real_distribution<float>{}(rng) < change_chance) {
+        local_indices = random_indices();
+        local_dyes = get_dye_values(local_indices);
+        erdyes::state::generations.local_dyes++;
+    }
+}
+
+const erdyes::state::dye_values &erdyes::local_player::get_selected_dyes() {
+    return local_dyes;
+}
+
+const array<int, 6> &erdyes::local_player::get_selected_indices() {
+    return local_indices;
+}
+
+static void make_palette() {
+    for (int i = 0; i < 64; i++) {
+        auto &color = erdyes::colors.emplace_back();
+        color.red = (i & 3) / 3.0f;
+        color.green = ((i >> 2) & 3) / 3.0f;
+        color.blue = ((i >> 4) & 3) / 3.0f;
+        color.animation_index = -1;
+    }
+    for (int i = 0; i < erdyes::config::intensity_count; i++) {
+        erdyes::intensities.emplace_back().intensity = 0.125f * (1 << i);
+    }
+}
+
+/**
+ * Send a player's dyes to the local player if they changed or it's time to resync
+ */
+static void send_player_dyes(sim_player &player, unsigned int palette_hash, uint64_t &bytes_sent) {
+    player.send_time += delta_time;
+    if (player.send_time < send_interval) {
+        return;
+    }
+    player.send_time -= send_interval;
+
+    if (!player.changed && --player.sends_until_resync > 0) {
+        return;
+    }
+    player.changed = false;
+    player.sends_until_resync = resync_interval_sends;
+
+    erdyes::dye_encoding::message_buffer message;
+    auto size = player.has_same_palette
+                    ? erdyes::dye_encoding::encode_indices(player.indices, palette_hash, message)
+                    : erdyes::dye_encoding::encode_values(get_dye_values(player.indices),
+                                                          ~palette_hash, message);
+    SteamNetworkingMessages()->deliver(player.steam_id, steam_networking_channel_dyes,
+                                       span{message.data(), size});
+    bytes_sent += size;
+}
+
+static double get_percentile(const vector<double> &sorted_values, double percentile) {
+    auto index = static_cast<size_t>(percentile / 100.0 * (sorted_values.size() - 1) + 0.5);
+    return sorted_values[index];
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2 || argc > 4) {
+        fprintf(stderr, "Usage: %s <other player count> [frame count] [capture file]\n", argv[0]);
+        return 1;
+    }
+
+    auto player_count = atoi(argv[1]);
+    auto frame_count = argc >= 3 ? atoi(argv[2]) : 600;
+    if (player_count < 0 || frame_count <= 0) {
+        fprintf(stderr, "Invalid player or frame count\n");
+        return 1;
+    }
+
+    make_palette();
+    auto palette_hash = erdyes::dye_encoding::hash_palette(erdyes::colors, erdyes::intensities);
+
+    // Set up the session with the local player and everyone else
+    static constexpr unsigned long long local_steam_id = 76561197960265728ull;
+    SteamUser()->fake_steam_id = local_steam_id;
+
+    auto main_player = sim_character{0};
+    auto world_chr_man = er::CS::WorldChrManImp{};
+    world_chr_man.main_player = &main_player.player;
+    er::CS::WorldChrManImp::fake_instance = &world_chr_man;
+
+    auto session_manager = er::CS::CSSessionManagerImp{};
+    session_manager.entries.push_back({.steam_id = local_steam_id});
+    er::CS::CSSessionManagerImp::fake_instance = &session_manager;
+
+    auto players = vector<sim_player>(player_count);
+    for (int i = 0; i < player_count; i++) {
+        auto &player = players[i];
+        player.steam_id = local_steam_id + 1 + i;
+        player.character = make_unique<sim_character>(player.steam_id);
+        player.has_same_palette = i % 4 != 0;
+        player.indices = random_indices();
+        player.changed = true;
+
+        // Spread out the sends like players who joined at different times
+        player.send_time = uniform_real_distribution<float>{0.0f, send_interval}(rng);
+
+        session_manager.entries.push_back({.steam_id = player.steam_id});
+    }
+
+    if (argc == 4) {
+        erdyes::capture::init(argv[3]);
+    }
+
+    erdyes::apply_materials_init();
+    auto player_update = modutils::get_detour<void(er::CS::PlayerIns *, float)>();
+
+    erdyes::net_players::init();
+
+    auto frame_times = vector<double>{};
+    frame_times.reserve(frame_count);
+    uint64_t bytes_received = 0;
+    uint64_t messages_received = 0;
+
+    auto next_frame = chrono::steady_clock::now();
+    for (int frame = 0; frame < frame_count; frame++) {
+        for (auto &player : players) {
+            if (uniform_real_distribution<float>{}(rng) < change_chance) {
+                player.indices = random_indices();
+                player.changed = true;
+            }
+
+            auto previous_bytes_received = bytes_received;
+            send_player_dyes(player, palette_hash, bytes_received);
+            messages_received += bytes_received != previous_bytes_received;
+        }
+
+        // The game updates the main player first, then everyone else
+        auto start_time = chrono::steady_clock::now();
+        player_update(&main_player.player, delta_time);
+        for (auto &player : players) {
+            player_update(&player.character->player, delta_time);
+        }
+        auto end_time = chrono::steady_clock::now();
+        frame_times.push_back(chrono::duration<double, micro>(end_time - start_time).count());
+
+        next_frame += chrono::microseconds{static_cast<long long>(delta_time * 1e6f)};
+        this_thread::sleep_until(next_frame);
+    }
+
+    erdyes::net_players::deinit();
+    erdyes::capture::deinit();
+
+    // Check that dyes actually made it through, since a fast frame that skipped them isn't useful
+    int dyed_player_count = 0;
+    int shown_player_count = 0;
+    for (auto &player : players) {
+        if (any_of(player.indices.begin(), player.indices.begin() + 3,
+                   [](int index) { return index != -1; })) {
+            dyed_player_count++;
+            if (player.character->modifier_module.modifiers.size() > game_modifier_names.size()) {
+                shown_player_count++;
+            }
+        }
+    }
+
+    auto seconds = frame_count * delta_time;
+    auto messages_sent = SteamNetworkingMessages()->messages_sent.load();
+    auto bytes_sent = SteamNetworkingMessages()->bytes_sent.load();
+
+    sort(frame_times.begin(), frame_times.end());
+    printf("%d other players, %d frames\n", player_count, frame_count);
+    printf("  mod time per frame (us)  p50 %.1f  p90 %.1f  p99 %.1f  max %.1f\n",
+           get_percentile(frame_times, 50), get_percentile(frame_times, 90),
+           get_percentile(frame_times, 99), frame_times.back());
+    printf("  sent                     %.1f messages/s  %.1f bytes/s\n", messages_sent / seconds,
+           bytes_sent / seconds);
+    printf("  received                 %.1f messages/s  %.1f bytes/s\n",
+           messages_received / seconds, bytes_received / seconds);
+    printf("  players with dyes shown  %d/%d\n", shown_player_count, dyed_player_count);
+
+    return 0;
+}
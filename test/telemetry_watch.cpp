@@ -0,0 +1,89 @@
+/**
+ * telemetry_watch.cpp
+ *
+ * Prints the telemetry counters of a process running the mod's portable code on Linux, once a
+ * second. This reads the POSIX shared memory stand-in the same way an overlay reads the named
+ * mapping on Windows: without locks, waiting for the magic number before trusting the header.
+ *
+ *   erdyes_telemetry_watch <process ID>
+ */
+#include "erdyes_telemetry.hpp"
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace std;
+
+int main(int argc, char *argv[]) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <process ID>\n", argv[0]);
+        return 1;
+    }
+
+    auto name = "/erdyes_telemetry_" + string{argv[1]};
+    auto fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd == -1) {
+        perror(name.c_str());
+        return 1;
+    }
+
+    auto view = mmap(nullptr, sizeof(erdyes::telemetry::counters_block), PROT_READ, MAP_SHARED, fd,
+                     0);
+    close(fd);
+    if (view == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+
+    auto &block = *static_cast<const erdyes::telemetry::counters_block *>(view);
+    while (atomic_ref{const_cast<uint32_t &>(block.magic)}.load(memory_order_acquire) !=
+           erdyes::telemetry::counters_magic) {
+        this_thread::sleep_for(chrono::milliseconds{100});
+    }
+
+    if (block.version != erdyes::telemetry::counters_version ||
+        block.size != sizeof(erdyes::telemetry::counters_block)) {
+        fprintf(stderr, "Unsupported counters version %u (size %u)\n", block.version, block.size);
+        return 1;
+    }
+
+    auto print = [](const char *name, const atomic<uint64_t> &counter) {
+        printf("  %-28s %llu\n", name,
+               static_cast<unsigned long long>(counter.load(memory_order_relaxed)));
+    };
+
+    for (;;) {
+        printf("Process %u\n", block.process_id);
+        print("player_update_calls", block.player_update_calls);
+        print("player_update_ns", block.player_update_ns);
+        print("goods_lookups", block.goods_lookups);
+        print("dummy_goods_lookups", block.dummy_goods_lookups);
+        print("message_lookups", block.message_lookups);
+        print("messages_sent", block.messages_sent);
+        print("bytes_sent", block.bytes_sent);
+        print("send_errors", block.send_errors);
+        print("messages_received", block.messages_received);
+        print("bytes_received", block.bytes_received);
+        print("messages_rejected", block.messages_rejected);
+        print("net_players", block.net_players);
+        print("net_slot_cache_hits", block.net_slot_cache_hits);
+        print("net_slot_cache_misses", block.net_slot_cache_misses);
+        print("palette_match_cache_hits", block.palette_match_cache_hits);
+        print("palette_match_cache_misses", block.palette_match_cache_misses);
+        fflush(stdout);
+
+        // The block stays mapped after the process exits, so stop once it's gone
+        if (kill(static_cast<pid_t>(block.process_id), 0) == -1) {
+            return 0;
+        }
+        this_thread::sleep_for(chrono::seconds{1});
+    }
+}